@@ -1,15 +1,62 @@
 #include "ADBClient.h"
 
 #include <map>
+#include <algorithm>
+#include <barrier>
 #include <ranges>
 #include <regex>
 #include <future>
 #include <numeric>
-#include <unordered_set>
+#include <limits>
 #include <cmath>
+#include <filesystem>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include "GestureRecorder.h"
+#include "InputEventDecoder.h"
+#include "Trajectory.h"
 #include "../src/ThreadPool.h"
 
 namespace ADBC {
+    namespace {
+        std::chrono::steady_clock::duration toClock(float seconds) {
+            return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<float>(seconds));
+        }
+
+        //FNV-1a over everything a replay plan depends on
+        uint64_t fingerprint(const std::vector<AndroidEvent>&events) {
+            uint64_t hash = 1469598103934665603ull;
+            auto mix = [&hash](const void* data, size_t size) {
+                for (size_t i = 0; i < size; i++) {
+                    hash = (hash ^ static_cast<const unsigned char *>(data)[i]) * 1099511628211ull;
+                }
+            };
+            auto mixPoints = [&mix](const std::vector<std::pair<float, Point>>&points) {
+                for (const auto&[time, point]: points) {
+                    mix(&time, sizeof(time));
+                    mix(&point.x, sizeof(point.x));
+                    mix(&point.y, sizeof(point.y));
+                }
+                mix("|", 1);
+            };
+            for (const auto&event: events) {
+                mix(event.type.data(), event.type.size());
+                mix(&event.start, sizeof(event.start));
+                mix(&event.end, sizeof(event.end));
+                mixPoints(event.points);
+                for (const auto&track: event.tracks) {
+                    mixPoints(track);
+                }
+                mix("#", 1);
+            }
+            return hash;
+        }
+    }
+
     std::string Execute(std::string executable, std::string args) {
         std::string cmd = executable + " " + args;
         std::string output;
@@ -30,6 +77,37 @@ namespace ADBC {
         return output;
     }
 
+    void ExecuteStream(const std::string&executable, const std::string&args,
+                       const std::function<void(std::string_view chunk)>&onChunk, bool binary) {
+        std::string cmd = executable + " " + args;
+        FILE* pipe = _popen(cmd.c_str(), binary ? "rb" : "r");
+        if (!pipe) throw std::runtime_error("popen() failed!");
+        try {
+            char buffer[4096];
+            if (binary) {
+                //Read whatever is available instead of waiting for fread to fill the buffer
+#ifdef _WIN32
+                for (int n; (n = _read(_fileno(pipe), buffer, sizeof(buffer))) > 0;) {
+#else
+                for (ssize_t n; (n = read(fileno(pipe), buffer, sizeof(buffer))) > 0;) {
+#endif
+                    onChunk(std::string_view(buffer, static_cast<size_t>(n)));
+                }
+            }
+            else {
+                //fgets returns at every newline, so lines reach the callback as soon as the command prints them
+                while (fgets(buffer, sizeof(buffer), pipe) != NULL) {
+                    onChunk(std::string_view(buffer));
+                }
+            }
+        }
+        catch (...) {
+            _pclose(pipe);
+            throw;
+        }
+        _pclose(pipe);
+    }
+
     ADBClient::ADBClient(const std::string&adbPath, const std::string&serial): adbPath(adbPath), serial(serial) {
         resolution = getResolution();
         AxisResolution = getAxisResolution();
@@ -211,11 +289,38 @@ namespace ADBC {
         return {static_cast<float>(AxisXToScreen(hex.first)), static_cast<float>(AxisYToScreen(hex.second))};
     }
 
-    void ADBClient::startRecordingAct() {
+    Point ADBClient::RawToScreen(int x, int y) const {
+        if (AxisResolution.width <= 0 || AxisResolution.height <= 0) {
+            return {static_cast<float>(x), static_cast<float>(y)};
+        }
+        return {
+            static_cast<float>(x * resolution.width / AxisResolution.width),
+            static_cast<float>(y * resolution.height / AxisResolution.height)
+        };
+    }
+
+    Point ADBClient::ScreenToRaw(Point p) const {
+        if (resolution.width <= 0 || resolution.height <= 0) {
+            return p;
+        }
+        return {
+            std::round(p.x * AxisResolution.width / resolution.width),
+            std::round(p.y * AxisResolution.height / resolution.height)
+        };
+    }
+
+    void ADBClient::startRecordingAct(std::function<void(const AndroidEvent&)> onEvent, RecordMode mode) {
         if (recording) {
             throw std::runtime_error("Recording is already in progress.");
         }
-        std::cout << "Start recording" << std::endl;
+        recordingDevice = mode == RecordMode::Raw ? touchDevice() : "";
+        recordMode = recordingDevice.empty() ? RecordMode::Text : RecordMode::Raw;
+        std::cout << "Start recording" << std::endl; {
+            std::lock_guard<std::mutex> lock(recordingMutex);
+            recordedEvents.clear();
+            pendingEvents.clear();
+            onRecordedEvent = std::move(onEvent);
+        }
         recording = true;
         recordingThread = std::thread(&ADBClient::recordAct, this);
     }
@@ -225,156 +330,419 @@ namespace ADBC {
             throw std::runtime_error("No recording is in progress.");
         }
         recording = false;
-        shell("pkill getevent");
+        shell(recordMode == RecordMode::Raw ? "pkill -f 'cat " + recordingDevice + "'" : "pkill getevent");
         std::cout << "Stop recording" << std::endl;
         if (recordingThread.joinable()) {
             recordingThread.join();
         }
+        std::lock_guard<std::mutex> lock(recordingMutex);
         return recordedEvents;
     }
 
-    void ADBClient::ReplayEvents(const std::vector<AndroidEvent>&events, bool control) const {
-        for (int i = 0; i < events.size() && control; i++) {
-            AndroidEvent event = events[i];
+    std::vector<AndroidEvent> ADBClient::pollRecordedEvents() {
+        std::lock_guard<std::mutex> lock(recordingMutex);
+        std::vector<AndroidEvent> events;
+        events.swap(pendingEvents);
+        return events;
+    }
 
-            if (event.type == "swipe") {
-                std::map<float, std::vector<TaskPoint>> taskInfo;
-                for (int j = 1; j < event.points.size(); j++) {
-                    float duration = event.points[j].first - event.points[j - 1].first;
-                    duration = std::max(duration, 0.05f);
-                    swipe(event.points[j - 1].second, event.points[j].second, duration);
+    ReplayReport ADBClient::ReplayEvents(const std::vector<AndroidEvent>&events, bool control) const {
+        if (events.empty() || !control) {
+            return {};
+        }
+        if (inputLatency < 0) {
+            calibrateLatency();
+        }
+        //Held while playing, a new plan would overwrite the injector the current one is reading
+        std::lock_guard<std::mutex> lock(replayMutex);
+        if (const uint64_t key = fingerprint(events); !replayPlan || replayKey != key) {
+            replayPlan = planReplay(events);
+            replayKey = key;
+        }
+        return playReplay(*replayPlan, Clock::now() + toClock(inputLatency));
+    }
+
+    ReplayReport ADBClient::ReplayEvents(const std::string&name, bool control) {
+        return ReplayEvents(getEvents(name), control);
+    }
 
-                    //Analog curve plotting using independent point-continuous integratorization
+    BroadcastReport ADBClient::Broadcast(const std::string&adbPath, const std::vector<std::string>&serials,
+                                         const std::vector<AndroidEvent>&events, Resolution source) {
+        BroadcastReport report;
+        report.devices.resize(serials.size());
+        if (serials.empty() || events.empty()) {
+            return report;
+        }
+        const Clock::time_point prepared = Clock::now();
+        std::vector<float> latencies(serials.size(), 0);
+        Clock::time_point begin;
+        //Runs once every device is prepared or has failed, before any of them is released
+        std::barrier sync(static_cast<std::ptrdiff_t>(serials.size()), [&]() noexcept {
+            report.preparation = std::chrono::duration<float>(Clock::now() - prepared).count();
+            //Far enough ahead that no device has to dispatch its first command in the past
+            begin = Clock::now() + toClock(*std::ranges::max_element(latencies) + 0.05f);
+        });
+
+        std::vector<std::thread> threads;
+        threads.reserve(serials.size());
+        for (size_t i = 0; i < serials.size(); i++) {
+            threads.emplace_back([&, i] {
+                DeviceReplay&device = report.devices[i];
+                device.serial = serials[i];
+                std::shared_ptr<ADBClient> client;
+                std::vector<AndroidEvent> scaled;
+                ReplayPlan plan;
+                try {
+                    client = Create(adbPath, serials[i]);
+                    scaled = client->scaleEvents(events, source);
+                    client->calibrateLatency();
+                    plan = client->planReplay(scaled);
+                    latencies[i] = client->inputLatency;
                 }
-                /*for (auto&tasks: taskInfo | std::views::values) {
-                    ThreadPool pool(tasks.size());
-
-                    std::vector<std::future<void>> futures;
-                    for (auto&task: tasks) {
-                        auto future = std::async(std::launch::async, [this, &task]() {
-                            swipe(task.p1, task.p2, task.duration);
-                        });
-                        futures.push_back(std::move(future));
-                    }
+                catch (const std::exception&e) {
+                    device.error = e.what();
+                    sync.arrive_and_drop();
+                    return;
+                }
+                sync.arrive_and_wait();
+                device.replay = client->playReplay(plan, begin);
+                device.completion = device.replay.actualDuration;
+            });
+        }
+        for (auto&thread: threads) {
+            thread.join();
+        }
+        return report;
+    }
 
-                    for (auto&future: futures) {
-                        future.wait();
+    ADBClient::ReplayPlan ADBClient::planReplay(const std::vector<AndroidEvent>&events) const {
+        ReplayPlan plan;
+        plan.events = events.size();
+        if (events.empty()) {
+            return plan;
+        }
+        const float origin = events.front().start;
+        //Swipes and multi-touch gestures are injected as raw input by one script for the whole replay, taps and
+        //key presses go through input commands
+        std::vector<std::vector<std::pair<float, Point>>> tracks;
+        std::vector<std::pair<int, float>> injected;
+        float injectStart = std::numeric_limits<float>::max();
+        float injectEnd = std::numeric_limits<float>::lowest();
+        auto inject = [&](const std::vector<std::pair<float, Point>>&track) {
+            tracks.push_back(track);
+            injectStart = std::min(injectStart, track.front().first);
+            injectEnd = std::max(injectEnd, track.back().first);
+        };
+        for (size_t e = 0; e < events.size(); e++) {
+            const AndroidEvent&event = events[e];
+            const int i = static_cast<int>(e);
+            if (event.type == "swipe" && event.points.size() > 1) {
+                inject(event.points);
+                injected.emplace_back(i, event.points.front().first - origin);
+            }
+            else if ((event.type == "tap" || event.type == "swipe") && !event.points.empty()) {
+                float duration = event.end - event.start;
+                Point p = event.points[0].second;
+                plan.commands.push_back({
+                    event.start - origin, duration, {{i, event.start - origin}},
+                    [this, p, duration] { tap(p, duration); }, true
+                });
+            }
+            else if (event.type == "multi" &&
+                     std::ranges::any_of(event.tracks, [](const auto&track) { return !track.empty(); })) {
+                for (const auto&track: event.tracks) {
+                    if (!track.empty()) {
+                        inject(track);
                     }
-                }*/
+                }
+                injected.emplace_back(i, event.start - origin);
             }
-            else if (event.type == "tap") {
-                tap(event.points[0].second, event.end - event.start);
+            plan.plannedDuration = std::max(plan.plannedDuration, event.end - origin);
+        }
+        if (!injected.empty()) {
+            if (const std::string script = pushTracks(tracks); !script.empty()) {
+                plan.commands.push_back({
+                    injectStart - origin, injectEnd - injectStart, std::move(injected),
+                    [this, script] { shell("sh " + script); }
+                });
             }
-            if (i != events.size() - 1) {
-                float delay = (events[i + 1].start - event.start) * 1000;
-                std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>(delay)));
+            else {
+                //No touch screen node to inject into, swipes fall back to input swipe one segment after another
+                for (const auto&[i, offset]: injected) {
+                    const AndroidEvent&event = events[i];
+                    if (event.type != "swipe") {
+                        continue;
+                    }
+                    plan.commands.push_back({
+                        offset, event.points.back().first - event.points.front().first, {{i, offset}},
+                        [this, points = event.points] {
+                            for (size_t j = 1; j < points.size(); j++) {
+                                swipe(points[j - 1].second, points[j].second,
+                                      std::max(points[j].first - points[j - 1].first, 0.05f));
+                            }
+                        }
+                    });
+                }
+            }
+        }
+        std::ranges::stable_sort(plan.commands, {}, &ReplayCommand::offset);
+        return plan;
+    }
+
+    ReplayReport ADBClient::playReplay(const ReplayPlan&plan, Clock::time_point begin) const {
+        ReplayReport report;
+        report.plannedDuration = plan.plannedDuration;
+        std::mutex reportMutex;
+        std::vector<bool> started(plan.events, false);
+        Clock::time_point finished = begin; {
+            ThreadPool pool(4);
+            for (const auto&command: plan.commands) {
+                const Clock::time_point due = begin + toClock(command.offset);
+                std::this_thread::sleep_until(due - toClock(inputLatency));
+                pool.enqueue([&, command] {
+                    const Clock::time_point issued = Clock::now();
+                    command.run();
+                    const Clock::time_point done = Clock::now();
+                    //What the round trip spent beyond the gesture itself is start-up latency. Injector scripts
+                    //spend an unknown share of it pushing frames late, they would only inflate the estimate.
+                    const float startup = std::max(
+                        std::chrono::duration<float>(done - issued).count() - command.duration, 0.0f);
+                    if (command.fixedCost) {
+                        updateLatency(startup);
+                    }
+                    std::lock_guard<std::mutex> lock(reportMutex);
+                    finished = std::max(finished, done);
+                    const float actual = std::chrono::duration<float>(issued - begin).count() + startup;
+                    for (const auto&[event, offset]: command.events) {
+                        if (!started[event]) {
+                            started[event] = true;
+                            //Events played by the same command follow its start by their planned distance
+                            report.events.push_back({event, offset, actual + offset - command.offset});
+                        }
+                    }
+                });
             }
+            //Leaving the scope joins the pool once every dispatched command returned
         }
+        std::ranges::sort(report.events, {}, &ReplayTiming::index);
+        report.actualDuration = std::chrono::duration<float>(finished - begin).count();
+        report.latency = inputLatency;
+        return report;
     }
 
-    void ADBClient::ReplayEvents(const std::string&name, bool control) {
-        ReplayEvents(getEvents(name), control);
+    std::vector<AndroidEvent> ADBClient::scaleEvents(const std::vector<AndroidEvent>&events, Resolution source) const {
+        if (source.width <= 0 || source.height <= 0 ||
+            (source.width == resolution.width && source.height == resolution.height)) {
+            return events;
+        }
+        const float sx = static_cast<float>(resolution.width) / source.width;
+        const float sy = static_cast<float>(resolution.height) / source.height;
+        auto scale = [sx, sy](std::vector<std::pair<float, Point>>&points) {
+            for (auto&[time, point]: points) {
+                point = {point.x * sx, point.y * sy};
+            }
+        };
+        std::vector<AndroidEvent> scaled = events;
+        for (auto&event: scaled) {
+            scale(event.points);
+            for (auto&track: event.tracks) {
+                scale(track);
+            }
+        }
+        return scaled;
     }
 
-    void ADBClient::recordAct() {
-        std::string output = shell("getevent -t");
-        std::istringstream f(output);
-        std::string line;
-        std::vector<std::pair<std::string, std::string>> points;
-        bool EventBegin = false;
-        std::regex timePattern(R"(\[\s*(\d+\.\d+)\s*\])");
-        AndroidEvent event;
-        std::smatch matches;
-        std::vector<float> times;
-        std::vector<std::vector<std::pair<float, Point>>> ProcessedPoints;
-        std::string lastX, lastY = "";
-        while (std::getline(f, line)) {
-            if (EventBegin) {
-                if (line.find("0003 0039") != std::string::npos) {
-                    std::string uid = line.substr(line.find("0003 0039") + std::string("0003 0039 ").length());
-                    if (std::regex_search(line, matches, timePattern)) {
-                        event.end = std::stof(matches[1]);
-                    }
-                    for (int i = 0; i < points.size(); i++) {
-                        event.points.emplace_back(times[i], AxisToScreen(points[i]));
-                    }
+    void ADBClient::calibrateLatency() const {
+        //KEYCODE_UNKNOWN goes through the same start-up as real input but does nothing
+        auto issued = std::chrono::steady_clock::now();
+        shell("input keyevent 0");
+        inputLatency = std::chrono::duration<float>(std::chrono::steady_clock::now() - issued).count();
+    }
 
+    void ADBClient::updateLatency(float sample) const {
+        float previous = inputLatency.load();
+        float next;
+        do {
+            next = previous < 0 ? sample : previous + 0.2f * (sample - previous);
+        }
+        while (!inputLatency.compare_exchange_weak(previous, next));
+    }
 
-                    if (points.size() > 1) {
-                        event.type = "swipe";
-                        float r = Rho(event.points);
-                        if (r < 0.9) {
-                            event.points = Optimize(event.points);
-                            /*for (int j = 1; j < event.points.size() - 1; j++) {
-                                ProcessedPoints.emplace_back(Optimize(event.points[j - 1], event.points[j]));
-                            }
-                            auto begin = event.points.front().first;
-                            event.points.clear();
-                            for (auto&p: ProcessedPoints) {
-                                for (auto&it: p) {
-                                    it.first -= begin;
-                                    event.points.emplace_back(it);
-                                }
-                            }*/
-                        }
-                        else {
-                            event.points.erase(event.points.begin() + 1, event.points.end() - 1);
-                        }
-                    }
-                    else if (points.size() == 1) {
-                        event.type = "tap";
-                    }
-                    else {
-                        continue;
-                    }
-                    if (uid != "ffffffff") {
-                        if (uid == event.id)
-                            EventBegin = false;
-                        else {
-                            event.id = uid;
-
-                            if (std::regex_search(line, matches, timePattern)) {
-                                event.start = std::stof(matches[1]);
-                            }
-                        }
+    void ADBClient::recordAct() {
+        GestureRecorder recorder([this](int x, int y) { return RawToScreen(x, y); },
+                                 [this](AndroidEvent event) {
+                                     event = shapeGesture(std::move(event));
+                                     std::function<void(const AndroidEvent&)> callback; {
+                                         std::lock_guard<std::mutex> lock(recordingMutex);
+                                         recordedEvents.push_back(event);
+                                         //Nobody polls while a callback takes the gestures, the queue would only grow
+                                         if (onRecordedEvent) {
+                                             callback = onRecordedEvent;
+                                         }
+                                         else {
+                                             pendingEvents.push_back(event);
+                                         }
+                                     }
+                                     if (callback) {
+                                         callback(event);
+                                     }
+                                 });
+        if (recordMode == RecordMode::Raw) {
+            InputEventDecoder decoder;
+            auto feed = [&recorder](const InputRecord&record) { recorder.Feed(record); };
+            ExecuteStream(adbPath, "-s " + serial + " exec-out cat " + recordingDevice,
+                          [&decoder, &feed](std::string_view chunk) { decoder.Feed(chunk, feed); }, true);
+            return;
+        }
+        LineSplitter lines([&recorder](std::string_view line) { recorder.FeedLine(line); });
+        ExecuteStream(adbPath, "-s " + serial + " shell getevent -t",
+                      [&lines](std::string_view chunk) { lines.Feed(chunk); });
+        lines.Flush();
+    }
+
+    std::string ADBClient::pushTracks(const std::vector<std::vector<std::pair<float, Point>>>&tracks) const {
+        if (!touchNodeResolved) {
+            touchNode = touchDevice();
+            touchNodeResolved = true;
+            if (touchNode.empty()) {
+                std::cerr << "No touch screen device found, gestures fall back to input commands" << std::endl;
+            }
+        }
+        if (touchNode.empty()) {
+            return "";
+        }
+        enum Phase { Down, Move, Up };
+        struct Sample {
+            float time;
+            int track;
+            Point p;
+            Phase phase;
+        };
+        std::vector<Sample> samples;
+        for (size_t t = 0; t < tracks.size(); t++) {
+            const auto&track = tracks[t];
+            for (size_t i = 0; i < track.size(); i++) {
+                samples.push_back({
+                    track[i].first, static_cast<int>(t), ScreenToRaw(track[i].second), i == 0 ? Down : Move
+                });
+            }
+            if (!track.empty()) {
+                samples.push_back({track.back().first, static_cast<int>(t), {}, Up});
+            }
+        }
+        std::ranges::stable_sort(samples, {}, &Sample::time);
+
+        if (injectLayout == InputEventDecoder::Layout::Auto) {
+            //dd runs as a native process, its struct input_event follows the device's primary ABI
+            injectLayout = shell("getprop ro.product.cpu.abi").find("64") != std::string::npos
+                               ? InputEventDecoder::Layout::Timeval64
+                               : InputEventDecoder::Layout::Timeval32;
+        }
+        //Frames of raw input_event records go out from one blob: per frame one dd writes the frame, instead of a
+        //sendevent process per field
+        std::string blob;
+        std::ostringstream script;
+        auto send = [&blob, this](uint16_t type, uint16_t code, int32_t value) {
+            InputEventDecoder::Encode(type, code, value, injectLayout, blob);
+        };
+        std::string name = "mio_replay_" + serial;
+        std::ranges::replace_if(name, [](char c) { return !std::isalnum(static_cast<unsigned char>(c)); }, '_');
+        const std::string remote = "/data/local/tmp/" + name;
+        script << "exec 3< " << remote << ".bin\n";
+        script << "exec 4>> " << touchNode << "\n";
+        //at waits until the given millisecond offset from the start: frames keep to the recording however long the
+        //dd before them took. Whole seconds and milliseconds apart keep the arithmetic within 32 bits for mksh.
+        script << "now() { t=$(date +%s.%N); n=${t#*.}; n=${n%??????}; "
+                "ms=$(( (${t%.*} - s0) * 1000 + 1$n - 1000 )); }\n";
+        script << "at() { now; d=$(( $1 - ms + m0 )); if [ $d -gt 0 ]; then f=$((1000 + d % 1000)); "
+                "sleep $((d / 1000)).${f#1}; fi; }\n";
+        script << "s0=$(date +%s); now; m0=$ms\n";
+        //Slots and tracking ids are handed out as fingers go down, gestures overlapping in time get separate ones
+        std::vector<int> slotOf(tracks.size(), -1);
+        std::vector<bool> slotUsed;
+        int trackingId = 0;
+        int down = 0;
+        const float first = samples.empty() ? 0 : samples.front().time;
+        for (size_t i = 0; i < samples.size();) {
+            const float time = samples[i].time;
+            script << "at " << std::lround((time - first) * 1000) << "\n";
+            const size_t frameStart = blob.size();
+            //Everything at the same instant goes out as one input frame
+            for (; i < samples.size() && samples[i].time == time; i++) {
+                const Sample&sample = samples[i];
+                int&slot = slotOf[sample.track];
+                if (sample.phase == Down) {
+                    const auto free = std::ranges::find(slotUsed, false);
+                    slot = static_cast<int>(free - slotUsed.begin());
+                    if (free == slotUsed.end()) {
+                        slotUsed.push_back(true);
                     }
                     else {
-                        EventBegin = false;
+                        *free = true;
                     }
-                    recordedEvents.push_back(event);
-                    event.points.clear();
-                    points.clear();
-                    times.clear();
                 }
-                else if (line.find("0003 0035") != std::string::npos) {
-                    if (std::regex_search(line, matches, timePattern)) {
-                        times.push_back(std::stof(matches[1]));
+                send(Input::EV_ABS, Input::ABS_MT_SLOT, slot);
+                if (sample.phase == Up) {
+                    slotUsed[slot] = false;
+                    send(Input::EV_ABS, Input::ABS_MT_TRACKING_ID, -1);
+                    if (--down == 0) {
+                        send(Input::EV_KEY, Input::BTN_TOUCH, 0);
                     }
-                    size_t pos = line.find("0003 0035");
-                    lastX = line.substr(pos + std::string("0003 0035 ").length());
-                    if (std::getline(f, line)) {
-                        if (line.find("0003 0036") != std::string::npos) {
-                            size_t pos = line.find("0003 0036");
-                            lastY = line.substr(pos + std::string("0003 0036 ").length());
-                        }
+                    continue;
+                }
+                if (sample.phase == Down) {
+                    send(Input::EV_ABS, Input::ABS_MT_TRACKING_ID, ++trackingId);
+                    if (down++ == 0) {
+                        send(Input::EV_KEY, Input::BTN_TOUCH, 1);
                     }
-                    points.emplace_back(lastX, lastY);
                 }
+                send(Input::EV_ABS, Input::ABS_MT_POSITION_X, static_cast<int32_t>(sample.p.x));
+                send(Input::EV_ABS, Input::ABS_MT_POSITION_Y, static_cast<int32_t>(sample.p.y));
             }
-            else {
-                if (line.find("0003 0039") != std::string::npos && line.find("ffffffff") == std::string::npos) {
-                    EventBegin = true;
-                    event.points.clear();
-                    points.clear();
-                    times.clear();
-                    event.id = line.substr(line.find("0003 0039") + std::string("0003 0039 ").length());
-
-                    if (std::regex_search(line, matches, timePattern)) {
-                        event.start = std::stof(matches[1]);
-                    }
+            send(Input::EV_SYN, Input::SYN_REPORT, 0);
+            //Reads continue where the previous dd stopped, fd 3 is shared
+            script << "dd bs=" << blob.size() - frameStart << " count=1 <&3 >&4 2>/dev/null\n";
+        }
+        script << "exec 3<&- 4>&-\n";
+
+        const auto local = std::filesystem::temp_directory_path() / name;
+        std::ofstream(local.string() + ".bin", std::ios::binary) << blob;
+        std::ofstream(local.string() + ".sh", std::ios::binary) << script.str();
+        push(local.string() + ".bin", remote + ".bin");
+        push(local.string() + ".sh", remote + ".sh");
+        std::error_code ec;
+        std::filesystem::remove(local.string() + ".bin", ec);
+        std::filesystem::remove(local.string() + ".sh", ec);
+        return remote + ".sh";
+    }
+
+    std::string ADBClient::touchDevice() const {
+        std::string output = shell("getevent -lp");
+        std::istringstream f(output);
+        std::string device;
+        for (std::string line; std::getline(f, line);) {
+            //"add device 2: /dev/input/event2"
+            if (line.starts_with("add device")) {
+                size_t pos = line.find("/dev/");
+                device = pos == std::string::npos ? "" : line.substr(pos);
+                while (!device.empty() && std::isspace(static_cast<unsigned char>(device.back()))) {
+                    device.pop_back();
                 }
             }
+            else if (line.find("ABS_MT_POSITION_X") != std::string::npos && !device.empty()) {
+                return device;
+            }
         }
+        return "";
+    }
+
+    AndroidEvent ADBClient::shapeGesture(AndroidEvent event) const {
+        //Each kept sample becomes one injected segment, keep only what the tolerance needs
+        event.points = Trajectory::SimplifyTimed(event.points, trajectoryTolerance);
+        for (auto&track: event.tracks) {
+            track = Trajectory::SimplifyTimed(track, trajectoryTolerance);
+        }
+        return event;
     }
 
     bool ADBClient::checkPackage(const std::string&packageName) const {
@@ -385,7 +753,14 @@ namespace ADBC {
     }
 
     void ADBClient::setID(const std::string&serial) {
-        this->serial = serial;
+        this->serial = serial; {
+            //The injector of the last plan was pushed to the previous device
+            std::lock_guard<std::mutex> lock(replayMutex);
+            replayPlan.reset();
+        }
+        touchNode.clear();
+        touchNodeResolved = false;
+        injectLayout = InputEventDecoder::Layout::Auto;
         resolution = getResolution();
         AxisResolution = getAxisResolution();
     }
@@ -397,103 +772,16 @@ namespace ADBC {
     std::vector<AndroidEvent> ADBClient::getEvents(const std::string&name) {
         if (events.contains(name))
             return events[name];
+        if (eventSource) {
+            auto found = eventSource(name);
+            if (!found.empty())
+                return found;
+        }
         std::cerr << "No events found." << std::endl;
         return {};
     }
 
-    std::vector<std::pair<float, Point>> ADBClient::Lerp(std::pair<float, Point> start, std::pair<float, Point> end,
-                                                         int steps) {
-        float duration = end.first - start.first;
-        std::vector<std::pair<float, Point>> points;
-        for (int i = 0; i < steps; i++) {
-            float t = static_cast<float>(i) / (steps - 1);
-            float x = start.second.x + (end.second.x - start.second.x) * t;
-            float y = start.second.y + (end.second.y - start.second.y) * t;
-            points.emplace_back(start.first + duration * t, Point{x, y});
-        }
-        return points;
-    }
-
-    std::vector<std::pair<float, Point>>
-    ADBClient::RemoveDuplicates(const std::vector<std::pair<float, Point>>&points) {
-        std::unordered_set<Point, PointHash> seenPoints;
-        std::vector<std::pair<float, Point>> result;
-
-        for (const auto&p: points) {
-            if (seenPoints.insert(p.second).second) {
-                result.push_back(p);
-            }
-        }
-
-        return result;
-    }
-
-
-    std::vector<std::pair<float, Point>> ADBClient::Optimize(std::pair<float, Point> point1,
-                                                             std::pair<float, Point> point2) {
-        std::vector<std::pair<float, Point>> optimizedPoints;
-        float deltaX = std::fabs(point1.second.x - point2.second.x);
-        float deltaY = std::fabs(point2.second.y - point1.second.y);
-        float distance = std::sqrt(
-            std::pow(point1.second.x - point2.second.x, 2) + std::pow(point2.second.y - point1.second.y, 2));
-        if (distance > 30) {
-            optimizedPoints.emplace_back(point1);
-            optimizedPoints.emplace_back(point2);
-        }
-        return optimizedPoints;
-        //return {point1, point2};
-    }
-
-    std::vector<std::pair<float, Point>> ADBClient::Optimize(const std::vector<std::pair<float, Point>>&points) {
-        std::vector<std::pair<float, Point>> optimized;
-
-        if (points.size() < 2) {
-            return points;
-        }
-
-        optimized.push_back(points[0]);
-
-        for (size_t i = 1; i < points.size() - 1; ++i) {
-            if (points[i].second.y >= points[i - 1].second.y && points[i].second.y >= points[i + 1].second.y) {
-                optimized.push_back(points[i]);
-            }
-            else if (points[i].second.y <= points[i - 1].second.y && points[i].second.y <= points[i + 1].second.y) {
-                optimized.push_back(points[i]);
-            }
-        }
-
-        optimized.push_back(points.back());
-
-        return optimized;
-    }
-
-    float ADBClient::DistanceToLine(const Point&p1, const Point&p2, const Point&p) {
-        float a = p2.y - p1.y;
-        float b = p1.x - p2.x;
-        float c = -a * p1.x - b * p1.y;
-        return std::abs(a * p.x + b * p.y + c) / std::sqrt(a * a + b * b);
-    }
-
-    float ADBClient::Rho(const std::vector<std::pair<float, Point>>&points) {
-        std::vector<double> Xn, Yn;
-        double sumX = 0, sumY = 0, avgX = 0, avgY = 0;
-        for (const auto&p: points) {
-            Xn.push_back(p.second.x);
-            Yn.push_back(p.second.y);
-            sumX += p.second.x;
-            sumY += p.second.y;
-        }
-        avgX = sumX / Xn.size();
-        avgY = sumY / Yn.size();
-
-        double sumXY = 0, sumX2 = 0, sumY2 = 0;
-        for (size_t i = 0; i < Xn.size(); ++i) {
-            sumXY += (Xn[i] - avgX) * (Yn[i] - avgY);
-            sumX2 += std::pow(Xn[i] - avgX, 2);
-            sumY2 += std::pow(Yn[i] - avgY, 2);
-        }
-
-        float correlation = sumXY / std::sqrt(sumX2 * sumY2);
-        return std::abs(correlation);
+    void ADBClient::setEventSource(std::function<std::vector<AndroidEvent>(const std::string&name)> source) {
+        eventSource = std::move(source);
     }
 }
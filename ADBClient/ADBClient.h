@@ -22,15 +22,28 @@
 #include <thread>
 #include <vector>
 #include <atomic>
+#include <chrono>
 #include <fstream>
 #include <iomanip>
 #include <map>
 #include <memory>
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <optional>
+#include <functional>
+#include <string_view>
+#include "InputEventDecoder.h"
 
 
 namespace ADBC {
     inline std::string Execute(std::string executable, std::string args);
 
+    //Runs a command and hands its output over as it arrives instead of collecting it. Binary output is passed on in
+    //whatever chunks the pipe delivers, text output line by line.
+    void ExecuteStream(const std::string&executable, const std::string&args,
+                       const std::function<void(std::string_view chunk)>&onChunk, bool binary = false);
+
     struct Point {
         float x;
         float y;
@@ -73,6 +86,95 @@ namespace ADBC {
         std::vector<std::pair<float, Point>> points; //time:point
         float start, end, duration;
         std::string id = "";
+        //"multi" events: one time:point track per finger, points holds the first of them
+        std::vector<std::vector<std::pair<float, Point>>> tracks;
+    };
+
+    enum class RecordMode {
+        Text, //Parse "getevent -t" output
+        Raw, //Decode struct input_event straight from the touch screen's device node
+    };
+
+    //Planned and estimated on-device start of one replayed event, in seconds from the start of the replay
+    struct ReplayTiming {
+        int index;
+        float planned;
+        float actual;
+
+        float error() const {
+            return actual - planned;
+        }
+    };
+
+    struct ReplayReport {
+        std::vector<ReplayTiming> events;
+        float plannedDuration = 0;
+        float actualDuration = 0;
+        //Command start-up latency the replay dispatched ahead by, measured per device
+        float latency = 0;
+
+        float MeanError() const {
+            float sum = 0;
+            for (const auto&event: events) {
+                sum += std::abs(event.error());
+            }
+            return events.empty() ? 0 : sum / events.size();
+        }
+
+        float MaxError() const {
+            float max = 0;
+            for (const auto&event: events) {
+                max = std::max(max, std::abs(event.error()));
+            }
+            return max;
+        }
+    };
+
+    struct DeviceReplay {
+        std::string serial;
+        ReplayReport replay;
+        //Seconds from the shared start until the device finished its last command, -1 if it never started
+        float completion = -1;
+        std::string error;
+
+        bool ok() const {
+            return error.empty();
+        }
+    };
+
+    struct BroadcastReport {
+        std::vector<DeviceReplay> devices;
+        //Seconds spent resolving devices and preparing commands before the shared start
+        float preparation = 0;
+
+        //Spread of the estimated on-device start of the first event across the devices that ran
+        float StartSkew() const {
+            return spread([](const DeviceReplay&device) {
+                return device.replay.events.empty() ? 0 : device.replay.events.front().actual;
+            });
+        }
+
+        //Spread of completion times across the devices that ran
+        float CompletionSkew() const {
+            return spread([](const DeviceReplay&device) { return device.completion; });
+        }
+
+    private:
+        template<typename F>
+        float spread(F value) const {
+            float min = 0, max = 0;
+            bool first = true;
+            for (const auto&device: devices) {
+                if (!device.ok()) {
+                    continue;
+                }
+                const float v = value(device);
+                min = first ? v : std::min(min, v);
+                max = first ? v : std::max(max, v);
+                first = false;
+            }
+            return max - min;
+        }
     };
 
     struct TaskPoint {
@@ -143,39 +245,58 @@ namespace ADBC {
 
         Point AxisToScreen(const std::pair<std::string, std::string>&hex) const;
 
-        void startRecordingAct();
+        Point RawToScreen(int x, int y) const;
+
+        Point ScreenToRaw(Point p) const;
+
+        //onEvent is called from the recording thread with every gesture as soon as it ends. Raw mode falls back to
+        //text when no touch screen node is found.
+        void startRecordingAct(std::function<void(const AndroidEvent&)> onEvent = nullptr,
+                               RecordMode mode = RecordMode::Raw);
 
         std::vector<AndroidEvent> stopRecordingAct();
 
-        void ReplayEvents(const std::vector<AndroidEvent>&events, bool control = true) const;
+        //Device node reporting ABS_MT_POSITION_X, e.g. "/dev/input/event2", empty if there is none
+        std::string touchDevice() const;
 
-        void ReplayEvents(const std::string&name, bool control = true);
+        //Gestures finished since the previous poll, for consumers that cannot take callbacks on another thread. Only
+        //filled while recording without an onEvent callback
+        std::vector<AndroidEvent> pollRecordedEvents();
 
-        bool checkPackage(const std::string&packageName) const;
+        //Plays events on an absolute timeline: each command is dispatched ahead of its due time by the measured
+        //start-up latency of adb input commands, so round trips do not add up over long macros. The plan and the
+        //raw input it pushed are kept, replaying the same events again on the same device pushes nothing.
+        ReplayReport ReplayEvents(const std::vector<AndroidEvent>&events, bool control = true) const;
 
-        void setID(const std::string&serial);
+        ReplayReport ReplayEvents(const std::string&name, bool control = true);
 
-        void loadEvents(const std::string&name, const std::vector<AndroidEvent>&event);
+        //Replays events on every device with a synchronized start. Each device is resolved, its latency measured
+        //and its commands scaled from the source resolution and prepared in parallel, then all of them are released
+        //together from a barrier onto one shared timeline. A source of 0x0 replays the coordinates unscaled.
+        static BroadcastReport Broadcast(const std::string&adbPath, const std::vector<std::string>&serials,
+                                         const std::vector<AndroidEvent>&events, Resolution source = Resolution(0, 0));
 
-        std::vector<AndroidEvent> getEvents(const std::string&name);
+        float getInputLatency() const {
+            return inputLatency;
+        }
 
-    private:
-        static std::vector<std::pair<float, Point>> Lerp(std::pair<float, Point> start, std::pair<float, Point> end,
-                                                         int steps = 16);
+        //Largest distance in pixels a simplified recording may stray from the captured path at any instant
+        void setTrajectoryTolerance(float pixels) {
+            trajectoryTolerance = pixels;
+        }
 
-        static std::vector<std::pair<float, Point>> RemoveDuplicates(const std::vector<std::pair<float, Point>>&);
+        bool checkPackage(const std::string&packageName) const;
 
-        static std::vector<std::pair<float, Point>>
-        Optimize(std::pair<float, Point> point1, std::pair<float, Point> point2);
+        void setID(const std::string&serial);
 
-        static std::vector<std::pair<float, Point>>
-        Optimize(const std::vector<std::pair<float, Point>>&points);
+        void loadEvents(const std::string&name, const std::vector<AndroidEvent>&event);
 
-        static float DistanceToLine(const Point&p1, const Point&p2, const Point&p);
+        std::vector<AndroidEvent> getEvents(const std::string&name);
 
-        //Liner Correlation Coefficient
-        static float Rho(const std::vector<std::pair<float, Point>>&);
+        //Consulted by getEvents for names that were not loaded into the client, so replays can be fetched lazily
+        void setEventSource(std::function<std::vector<AndroidEvent>(const std::string&name)> source);
 
+    private:
         static int HexToDec(std::string hexString) {
             std::string trimmedHexString = hexString;
             std::erase(trimmedHexString, ' ');
@@ -192,14 +313,67 @@ namespace ADBC {
         }
 
 
+        using Clock = std::chrono::steady_clock;
+
+        struct ReplayCommand {
+            float offset;
+            float duration;
+            //Index and offset of every event the command plays, the injector plays all raw gestures of a replay
+            std::vector<std::pair<int, float>> events;
+            std::function<void()> run;
+            //Set for input taps: their round trip is the start-up plus the tap, so only they feed the latency estimate
+            bool fixedCost = false;
+        };
+
+        struct ReplayPlan {
+            std::vector<ReplayCommand> commands;
+            size_t events = 0;
+            float plannedDuration = 0;
+        };
+
         void recordAct();
 
+        //Lays the events out on their timeline, the raw input injector is pushed to the device here
+        ReplayPlan planReplay(const std::vector<AndroidEvent>&events) const;
+
+        //Dispatches every command ahead of begin + offset by the input latency
+        ReplayReport playReplay(const ReplayPlan&plan, Clock::time_point begin) const;
+
+        std::vector<AndroidEvent> scaleEvents(const std::vector<AndroidEvent>&events, Resolution source) const;
+
+        AndroidEvent shapeGesture(AndroidEvent event) const;
+
+        void calibrateLatency() const;
+
+        void updateLatency(float sample) const;
+
+        //Pushes one blob of raw input events playing every track as one finger and one script writing its frames to
+        //the touch screen at their offsets from the first sample. Returns the script's path on the device or an
+        //empty string if there is no touch screen. Both files stay on the device to be played again.
+        std::string pushTracks(const std::vector<std::vector<std::pair<float, Point>>>&tracks) const;
+
         Resolution resolution = Resolution(0, 0);
         Resolution AxisResolution = Resolution(0, 0);
         std::atomic<bool> recording = false;
         std::thread recordingThread;
         std::vector<AndroidEvent> recordedEvents;
+        std::vector<AndroidEvent> pendingEvents;
+        std::function<void(const AndroidEvent&)> onRecordedEvent;
+        RecordMode recordMode = RecordMode::Text;
+        std::string recordingDevice;
+        mutable std::string touchNode;
+        mutable bool touchNodeResolved = false;
+        mutable InputEventDecoder::Layout injectLayout = InputEventDecoder::Layout::Auto;
+        //Seconds between issuing an input command and the device acting on it, exponentially averaged
+        mutable std::atomic<float> inputLatency = -1;
+        //The last plan ReplayEvents made and a fingerprint of the events it was made for, held while it plays
+        mutable std::mutex replayMutex;
+        mutable std::optional<ReplayPlan> replayPlan;
+        mutable uint64_t replayKey = 0;
+        float trajectoryTolerance = 6;
+        std::mutex recordingMutex;
         std::map<std::string, std::vector<AndroidEvent>> events;
+        std::function<std::vector<AndroidEvent>(const std::string&name)> eventSource;
         std::string adbPath;
         std::string serial;
     };
@@ -0,0 +1,173 @@
+#include "GestureRecorder.h"
+
+namespace ADBC {
+    LineSplitter::LineSplitter(std::function<void(std::string_view)> onLine): onLine(std::move(onLine)) {
+    }
+
+    void LineSplitter::Feed(std::string_view chunk) {
+        while (!chunk.empty()) {
+            size_t newline = chunk.find('\n');
+            if (newline == std::string_view::npos) {
+                if (partial.size() + chunk.size() > MaxLine) {
+                    //Not a getevent line, drop it instead of growing without bound
+                    partial.clear();
+                    return;
+                }
+                partial.append(chunk);
+                return;
+            }
+            std::string_view line = chunk.substr(0, newline);
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            if (partial.empty()) {
+                onLine(line);
+            }
+            else {
+                partial.append(line);
+                onLine(partial);
+                partial.clear();
+            }
+            chunk.remove_prefix(newline + 1);
+        }
+    }
+
+    void LineSplitter::Flush() {
+        if (!partial.empty()) {
+            onLine(partial);
+            partial.clear();
+        }
+    }
+
+    GestureRecorder::GestureRecorder(ToScreen toScreen, Callback onGesture): toScreen(std::move(toScreen)),
+        onGesture(std::move(onGesture)) {
+    }
+
+    void GestureRecorder::FeedLine(std::string_view line) {
+        InputRecord record;
+        if (ParseGeteventLine(line, record)) {
+            Feed(record);
+        }
+    }
+
+    void GestureRecorder::Feed(const InputRecord&record) {
+        if (origin < 0) {
+            origin = record.time;
+        }
+        const auto time = static_cast<float>(record.time - origin);
+        if (record.type == Input::EV_SYN && record.code == Input::SYN_REPORT) {
+            flushPoints();
+            return;
+        }
+        if (record.type != Input::EV_ABS) {
+            return;
+        }
+        switch (record.code) {
+            case Input::ABS_MT_SLOT:
+                //Devices without slots report everything on slot 0
+                slot = std::min<size_t>(static_cast<size_t>(std::max(record.value, 0)), MaxSlots - 1);
+                break;
+            case Input::ABS_MT_TRACKING_ID: {
+                Slot&current = slots[slot];
+                if (record.value == -1) {
+                    lift(current, time);
+                }
+                else if (record.value != current.trackingId) {
+                    touch(current, record.value, time);
+                }
+                break;
+            }
+            case Input::ABS_MT_POSITION_X:
+            case Input::ABS_MT_POSITION_Y: {
+                Slot&current = slots[slot];
+                if (!current.dirty) {
+                    current.pointTime = time;
+                }
+                (record.code == Input::ABS_MT_POSITION_X ? current.x : current.y) = record.value;
+                current.dirty = true;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void GestureRecorder::Reset() {
+        origin = -1;
+        slots = {};
+        slot = 0;
+        down = 0;
+        tracks.clear();
+    }
+
+    void GestureRecorder::touch(Slot&slot, int32_t id, float time) {
+        if (slot.trackingId != -1) {
+            //A new contact replaced the old one without an explicit lift
+            lift(slot, time);
+        }
+        if (down == 0) {
+            start = time;
+            this->id = std::to_string(id);
+            tracks.clear();
+        }
+        slot.trackingId = id;
+        slot.track = tracks.size();
+        slot.dirty = false;
+        tracks.emplace_back();
+        down++;
+    }
+
+    void GestureRecorder::lift(Slot&slot, float time) {
+        if (slot.trackingId == -1) {
+            return;
+        }
+        flushPoints();
+        auto&track = tracks[slot.track];
+        //Keep how long the finger rested after its last move
+        if (!track.empty() && time > track.back().first) {
+            track.emplace_back(time, track.back().second);
+        }
+        slot.trackingId = -1;
+        slot.dirty = false;
+        if (--down == 0) {
+            finish(time);
+        }
+    }
+
+    void GestureRecorder::finish(float time) {
+        std::erase_if(tracks, [](const auto&track) { return track.empty(); });
+        if (tracks.empty()) {
+            return;
+        }
+        AndroidEvent event;
+        event.id = id;
+        event.start = start;
+        event.end = time;
+        event.duration = event.end - event.start;
+        if (tracks.size() == 1) {
+            event.points = std::move(tracks.front());
+            //The resting sample is only needed to time multi-finger lifts
+            if (event.points.size() > 1 && event.points.back().second == event.points[event.points.size() - 2].second) {
+                event.points.pop_back();
+            }
+            event.type = event.points.size() > 1 ? "swipe" : "tap";
+        }
+        else {
+            event.type = "multi";
+            event.points = tracks.front();
+            event.tracks = std::move(tracks);
+        }
+        tracks.clear();
+        onGesture(std::move(event));
+    }
+
+    void GestureRecorder::flushPoints() {
+        for (auto&slot: slots) {
+            if (slot.trackingId == -1 || !slot.dirty || slot.x < 0 || slot.y < 0) {
+                continue;
+            }
+            tracks[slot.track].emplace_back(slot.pointTime, toScreen(slot.x, slot.y));
+            slot.dirty = false;
+        }
+    }
+}
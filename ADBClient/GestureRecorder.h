@@ -0,0 +1,85 @@
+#ifndef GESTURERECORDER_H
+#define GESTURERECORDER_H
+
+#include <array>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ADBClient.h"
+#include "GeteventParser.h"
+
+namespace ADBC {
+    //Splits a byte stream into lines as chunks arrive. At most one partial line is held between chunks.
+    class LineSplitter {
+    public:
+        explicit LineSplitter(std::function<void(std::string_view)> onLine);
+
+        void Feed(std::string_view chunk);
+
+        //Delivers a trailing line without a newline, if any
+        void Flush();
+
+    private:
+        static constexpr size_t MaxLine = 4096;
+
+        std::function<void(std::string_view)> onLine;
+        std::string partial;
+    };
+
+    //Turns getevent -t/-lt lines or decoded input records into gestures as they arrive. Pointers are tracked per
+    //ABS_MT_SLOT, a gesture lasts from the first finger down until the last one lifts. One finger produces a tap or
+    //swipe, concurrent fingers a "multi" event with one track per finger. Only the gesture in progress is buffered.
+    //Times are seconds since the first record, device uptimes are too large for float precision.
+    class GestureRecorder {
+    public:
+        using ToScreen = std::function<Point(int x, int y)>;
+        using Callback = std::function<void(AndroidEvent)>;
+
+        GestureRecorder(ToScreen toScreen, Callback onGesture);
+
+        void FeedLine(std::string_view line);
+
+        void Feed(const InputRecord&record);
+
+        void Reset();
+
+        bool InGesture() const {
+            return !tracks.empty();
+        }
+
+    private:
+        struct Slot {
+            int32_t trackingId = -1;
+            int x = -1;
+            int y = -1;
+            float pointTime = 0;
+            bool dirty = false;
+            //Index into tracks of the finger currently on this slot
+            size_t track = 0;
+        };
+
+        static constexpr size_t MaxSlots = 16;
+
+        void touch(Slot&slot, int32_t id, float time);
+
+        void lift(Slot&slot, float time);
+
+        void finish(float time);
+
+        void flushPoints();
+
+        ToScreen toScreen;
+        Callback onGesture;
+        double origin = -1;
+        std::array<Slot, MaxSlots> slots;
+        size_t slot = 0;
+        size_t down = 0;
+        float start = 0;
+        std::string id;
+        std::vector<std::vector<std::pair<float, Point>>> tracks;
+    };
+}
+
+
+#endif //GESTURERECORDER_H
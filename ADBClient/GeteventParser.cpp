@@ -0,0 +1,144 @@
+#include "GeteventParser.h"
+
+#include <array>
+#include <utility>
+
+namespace ADBC {
+    namespace {
+        using Label = std::pair<std::string_view, uint16_t>;
+
+        constexpr std::array<Label, 3> TypeLabels{
+            {
+                {"EV_SYN", Input::EV_SYN}, {"EV_KEY", Input::EV_KEY}, {"EV_ABS", Input::EV_ABS}
+            }
+        };
+
+        constexpr std::array<Label, 27> CodeLabels{
+            {
+                {"SYN_REPORT", Input::SYN_REPORT}, {"SYN_MT_REPORT", Input::SYN_MT_REPORT},
+                {"SYN_DROPPED", Input::SYN_DROPPED}, {"BTN_TOOL_FINGER", Input::BTN_TOOL_FINGER},
+                {"BTN_TOUCH", Input::BTN_TOUCH}, {"ABS_X", Input::ABS_X}, {"ABS_Y", Input::ABS_Y},
+                {"ABS_PRESSURE", Input::ABS_PRESSURE}, {"ABS_MT_SLOT", Input::ABS_MT_SLOT},
+                {"ABS_MT_TOUCH_MAJOR", Input::ABS_MT_TOUCH_MAJOR}, {"ABS_MT_TOUCH_MINOR", Input::ABS_MT_TOUCH_MINOR},
+                {"ABS_MT_WIDTH_MAJOR", Input::ABS_MT_WIDTH_MAJOR}, {"ABS_MT_WIDTH_MINOR", Input::ABS_MT_WIDTH_MINOR},
+                {"ABS_MT_ORIENTATION", Input::ABS_MT_ORIENTATION}, {"ABS_MT_POSITION_X", Input::ABS_MT_POSITION_X},
+                {"ABS_MT_POSITION_Y", Input::ABS_MT_POSITION_Y}, {"ABS_MT_TOOL_TYPE", Input::ABS_MT_TOOL_TYPE},
+                {"ABS_MT_BLOB_ID", Input::ABS_MT_BLOB_ID}, {"ABS_MT_TRACKING_ID", Input::ABS_MT_TRACKING_ID},
+                {"ABS_MT_PRESSURE", Input::ABS_MT_PRESSURE}, {"ABS_MT_DISTANCE", Input::ABS_MT_DISTANCE},
+                {"ABS_MT_TOOL_X", Input::ABS_MT_TOOL_X}, {"ABS_MT_TOOL_Y", Input::ABS_MT_TOOL_Y},
+                //Key values in -l mode
+                {"UP", 0}, {"DOWN", 1}, {"REPEAT", 2}, {"SYN_CONFIG", 0x01}
+            }
+        };
+
+        constexpr bool isSpace(char c) {
+            return c == ' ' || c == '\t';
+        }
+
+        constexpr std::string_view nextToken(std::string_view&rest) {
+            size_t i = 0;
+            while (i < rest.size() && isSpace(rest[i])) {
+                i++;
+            }
+            size_t begin = i;
+            while (i < rest.size() && !isSpace(rest[i])) {
+                i++;
+            }
+            std::string_view token = rest.substr(begin, i - begin);
+            rest.remove_prefix(i);
+            return token;
+        }
+
+        constexpr int hexDigit(char c) {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+
+        constexpr bool parseHex(std::string_view token, uint32_t&value) {
+            if (token.empty() || token.size() > 8) {
+                return false;
+            }
+            uint32_t result = 0;
+            for (char c: token) {
+                int digit = hexDigit(c);
+                if (digit < 0) {
+                    return false;
+                }
+                result = result << 4 | static_cast<uint32_t>(digit);
+            }
+            value = result;
+            return true;
+        }
+
+        //Hex as printed by getevent -t, or a symbolic name as printed by -l
+        template<size_t N>
+        constexpr bool parseField(std::string_view token, const std::array<Label, N>&labels, uint32_t&value) {
+            if (parseHex(token, value)) {
+                return true;
+            }
+            for (const auto&[name, code]: labels) {
+                if (name == token) {
+                    value = code;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        //"12345.678901", seconds with up to microsecond precision
+        constexpr bool parseTime(std::string_view token, double&time) {
+            uint64_t seconds = 0;
+            size_t i = 0;
+            for (; i < token.size() && token[i] >= '0' && token[i] <= '9'; i++) {
+                seconds = seconds * 10 + static_cast<uint64_t>(token[i] - '0');
+            }
+            if (i == 0) {
+                return false;
+            }
+            uint64_t fraction = 0;
+            uint64_t scale = 1;
+            if (i < token.size() && token[i] == '.') {
+                for (i++; i < token.size() && token[i] >= '0' && token[i] <= '9'; i++) {
+                    fraction = fraction * 10 + static_cast<uint64_t>(token[i] - '0');
+                    scale *= 10;
+                }
+            }
+            if (i != token.size()) {
+                return false;
+            }
+            time = static_cast<double>(seconds) + static_cast<double>(fraction) / static_cast<double>(scale);
+            return true;
+        }
+    }
+
+    bool ParseGeteventLine(std::string_view line, InputRecord&record) {
+        size_t open = line.find('[');
+        size_t close = line.find(']', open);
+        if (open == std::string_view::npos || close == std::string_view::npos) {
+            return false;
+        }
+        std::string_view stamp = line.substr(open + 1, close - open - 1);
+        std::string_view rest = line.substr(close + 1);
+        if (!parseTime(nextToken(stamp), record.time)) {
+            return false;
+        }
+
+        std::string_view token = nextToken(rest);
+        record.device = {};
+        if (!token.empty() && token.back() == ':') {
+            record.device = token.substr(0, token.size() - 1);
+            token = nextToken(rest);
+        }
+        uint32_t type, code, value;
+        if (!parseField(token, TypeLabels, type) || !parseField(nextToken(rest), CodeLabels, code) ||
+            !parseField(nextToken(rest), CodeLabels, value)) {
+            return false;
+        }
+        record.type = static_cast<uint16_t>(type);
+        record.code = static_cast<uint16_t>(code);
+        record.value = static_cast<int32_t>(value);
+        return true;
+    }
+}
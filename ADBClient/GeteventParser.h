@@ -0,0 +1,58 @@
+#ifndef GETEVENTPARSER_H
+#define GETEVENTPARSER_H
+
+#include <cstdint>
+#include <string_view>
+
+namespace ADBC {
+    //Linux input event types and codes used by touch screens (linux/input-event-codes.h)
+    namespace Input {
+        constexpr uint16_t EV_SYN = 0x00;
+        constexpr uint16_t EV_KEY = 0x01;
+        constexpr uint16_t EV_ABS = 0x03;
+
+        constexpr uint16_t SYN_REPORT = 0x00;
+        constexpr uint16_t SYN_MT_REPORT = 0x02;
+        constexpr uint16_t SYN_DROPPED = 0x03;
+
+        constexpr uint16_t BTN_TOOL_FINGER = 0x145;
+        constexpr uint16_t BTN_TOUCH = 0x14a;
+
+        constexpr uint16_t ABS_X = 0x00;
+        constexpr uint16_t ABS_Y = 0x01;
+        constexpr uint16_t ABS_PRESSURE = 0x18;
+        constexpr uint16_t ABS_MT_SLOT = 0x2f;
+        constexpr uint16_t ABS_MT_TOUCH_MAJOR = 0x30;
+        constexpr uint16_t ABS_MT_TOUCH_MINOR = 0x31;
+        constexpr uint16_t ABS_MT_WIDTH_MAJOR = 0x32;
+        constexpr uint16_t ABS_MT_WIDTH_MINOR = 0x33;
+        constexpr uint16_t ABS_MT_ORIENTATION = 0x34;
+        constexpr uint16_t ABS_MT_POSITION_X = 0x35;
+        constexpr uint16_t ABS_MT_POSITION_Y = 0x36;
+        constexpr uint16_t ABS_MT_TOOL_TYPE = 0x37;
+        constexpr uint16_t ABS_MT_BLOB_ID = 0x38;
+        constexpr uint16_t ABS_MT_TRACKING_ID = 0x39;
+        constexpr uint16_t ABS_MT_PRESSURE = 0x3a;
+        constexpr uint16_t ABS_MT_DISTANCE = 0x3b;
+        constexpr uint16_t ABS_MT_TOOL_X = 0x3c;
+        constexpr uint16_t ABS_MT_TOOL_Y = 0x3d;
+    }
+
+    //One decoded input_event. device points into the parsed line and is empty when getevent printed no device.
+    struct InputRecord {
+        double time = 0;
+        uint16_t type = 0;
+        uint16_t code = 0;
+        int32_t value = 0;
+        std::string_view device;
+    };
+
+    //Parses one line of "getevent -t" or "getevent -lt" output, with or without the device prefix:
+    //  [   12345.678901] /dev/input/event2: 0003 0035 000001a2
+    //  [   12345.678901] /dev/input/event2: EV_ABS       ABS_MT_POSITION_X    000001a2
+    //Works in place on the line without allocating. Returns false for headers, blank and malformed lines.
+    bool ParseGeteventLine(std::string_view line, InputRecord&record);
+}
+
+
+#endif //GETEVENTPARSER_H
@@ -0,0 +1,123 @@
+#include "InputEventDecoder.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace ADBC {
+    namespace {
+        template<typename T>
+        T read(const char* bytes) {
+            T value;
+            std::memcpy(&value, bytes, sizeof(T));
+            return value;
+        }
+
+        bool knownType(uint16_t type) {
+            //EV_SYN ... EV_MSC, EV_SW, EV_LED ... EV_FF_STATUS
+            return type <= 0x05 || (type >= 0x11 && type <= 0x17);
+        }
+    }
+
+    InputEventDecoder::InputEventDecoder(Layout layout): layout(layout) {
+        pending.reserve(DetectBytes);
+    }
+
+    size_t InputEventDecoder::Feed(std::string_view bytes, const Callback&onRecord) {
+        if (layout == Layout::Auto) {
+            pending.append(bytes);
+            if (pending.size() < DetectBytes) {
+                return 0;
+            }
+            layout = plausible(pending, Layout::Timeval64)
+                         ? Layout::Timeval64
+                         : plausible(pending, Layout::Timeval32)
+                               ? Layout::Timeval32
+                               : Layout::Timeval64;
+            std::string buffered;
+            buffered.swap(pending);
+            return Feed(buffered, onRecord);
+        }
+
+        const size_t size = RecordSize(layout);
+        size_t count = 0;
+        if (!pending.empty()) {
+            size_t take = std::min(size - pending.size(), bytes.size());
+            pending.append(bytes.substr(0, take));
+            bytes.remove_prefix(take);
+            if (pending.size() < size) {
+                return 0;
+            }
+            onRecord(decode(pending.data(), layout));
+            pending.clear();
+            count++;
+        }
+        for (; bytes.size() >= size; bytes.remove_prefix(size)) {
+            onRecord(decode(bytes.data(), layout));
+            count++;
+        }
+        pending.assign(bytes);
+        return count;
+    }
+
+    std::vector<InputRecord> InputEventDecoder::DecodeDump(const std::string&path, Layout layout) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Failed to open input dump " << path << std::endl;
+            return {};
+        }
+        std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (layout == Layout::Auto && bytes.size() < DetectBytes) {
+            layout = Layout::Timeval64;
+        }
+        std::vector<InputRecord> records;
+        InputEventDecoder decoder(layout);
+        decoder.Feed(bytes, [&records](const InputRecord&record) { records.push_back(record); });
+        return records;
+    }
+
+    bool InputEventDecoder::plausible(std::string_view bytes, Layout layout) {
+        const size_t size = RecordSize(layout);
+        for (size_t offset = 0; offset + size <= bytes.size(); offset += size) {
+            const char* record = bytes.data() + offset;
+            if (layout == Layout::Timeval64) {
+                //Uptimes and microseconds never reach the upper halves of the 64-bit fields
+                if (read<int64_t>(record) >> 32 != 0 || read<uint64_t>(record + 8) >= 1000000 ||
+                    !knownType(read<uint16_t>(record + 16))) {
+                    return false;
+                }
+            }
+            else if (read<uint32_t>(record + 4) >= 1000000 || !knownType(read<uint16_t>(record + 8))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void InputEventDecoder::Encode(uint16_t type, uint16_t code, int32_t value, Layout layout, std::string&out) {
+        out.append(layout == Layout::Timeval32 ? 8 : 16, '\0');
+        out.append(reinterpret_cast<const char *>(&type), sizeof(type));
+        out.append(reinterpret_cast<const char *>(&code), sizeof(code));
+        out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    InputRecord InputEventDecoder::decode(const char* record, Layout layout) {
+        //Android devices are little-endian, as are the hosts this runs on
+        InputRecord result;
+        size_t header;
+        if (layout == Layout::Timeval32) {
+            result.time = read<int32_t>(record) + read<int32_t>(record + 4) / 1e6;
+            header = 8;
+        }
+        else {
+            result.time = static_cast<double>(read<int64_t>(record)) +
+                          static_cast<double>(read<int64_t>(record + 8)) / 1e6;
+            header = 16;
+        }
+        result.type = read<uint16_t>(record + header);
+        result.code = read<uint16_t>(record + header + 2);
+        result.value = read<int32_t>(record + header + 4);
+        return result;
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef INPUTEVENTDECODER_H
+#define INPUTEVENTDECODER_H
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "GeteventParser.h"
+
+namespace ADBC {
+    //Decodes raw struct input_event bytes as read from /dev/input/eventN. The struct starts with a timeval whose
+    //fields are 32 bits on 32-bit userlands (16 byte records) and 64 bits on 64-bit ones (24 byte records). Input is
+    //taken in arbitrary chunks, at most one partial record is carried over between them.
+    class InputEventDecoder {
+    public:
+        enum class Layout {
+            Auto, //Decide from the first records
+            Timeval32,
+            Timeval64,
+        };
+
+        using Callback = std::function<void(const InputRecord&)>;
+
+        explicit InputEventDecoder(Layout layout = Layout::Auto);
+
+        //Returns the number of records decoded from this chunk
+        size_t Feed(std::string_view bytes, const Callback&onRecord);
+
+        Layout GetLayout() const {
+            return layout;
+        }
+
+        static size_t RecordSize(Layout layout) {
+            return layout == Layout::Timeval32 ? 16 : 24;
+        }
+
+        //Decodes a captured dump, e.g. from "adb exec-out cat /dev/input/event2 > touch.bin"
+        static std::vector<InputRecord> DecodeDump(const std::string&path, Layout layout = Layout::Auto);
+
+        //Appends the record as written to a device node, the kernel stamps the time itself so it is left zero
+        static void Encode(uint16_t type, uint16_t code, int32_t value, Layout layout, std::string&out);
+
+    private:
+        static bool plausible(std::string_view bytes, Layout layout);
+
+        static InputRecord decode(const char* record, Layout layout);
+
+        //Enough bytes to see whole records under either layout
+        static constexpr size_t DetectBytes = 48;
+
+        Layout layout;
+        std::string pending;
+    };
+}
+
+
+#endif //INPUTEVENTDECODER_H
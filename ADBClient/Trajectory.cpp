@@ -0,0 +1,117 @@
+#include "Trajectory.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ADBC {
+    std::vector<Trajectory::Sample> Trajectory::Simplify(const std::vector<Sample>&samples, float tolerance) {
+        return douglasPeucker(samples, tolerance, [](const Sample&first, const Sample&last, const Sample&sample) {
+            return DistanceToLine(first.second, last.second, sample.second);
+        });
+    }
+
+    std::vector<Trajectory::Sample> Trajectory::SimplifyTimed(const std::vector<Sample>&samples, float tolerance) {
+        return douglasPeucker(samples, tolerance, [](const Sample&first, const Sample&last, const Sample&sample) {
+            return Distance(Interpolate(first, last, sample.first), sample.second);
+        });
+    }
+
+    std::vector<Trajectory::Sample> Trajectory::Resample(const std::vector<Sample>&samples, float maxStep) {
+        if (samples.size() < 2 || maxStep <= 0) {
+            return samples;
+        }
+        std::vector<Sample> result;
+        result.reserve(samples.size());
+        result.push_back(samples.front());
+        for (size_t i = 1; i < samples.size(); i++) {
+            const Sample&from = samples[i - 1];
+            const Sample&to = samples[i];
+            const int steps = static_cast<int>(std::ceil(Distance(from.second, to.second) / maxStep));
+            for (int step = 1; step < steps; step++) {
+                float time = from.first + (to.first - from.first) * step / steps;
+                result.emplace_back(time, Interpolate(from, to, time));
+            }
+            result.push_back(to);
+        }
+        return result;
+    }
+
+    float Trajectory::Deviation(const std::vector<Sample>&original, const std::vector<Sample>&kept) {
+        if (kept.empty()) {
+            return original.empty() ? 0 : INFINITY;
+        }
+        float deviation = 0;
+        size_t segment = 0;
+        for (const auto&sample: original) {
+            while (segment + 2 < kept.size() && kept[segment + 1].first < sample.first) {
+                segment++;
+            }
+            Point replayed = kept.size() == 1
+                                 ? kept.front().second
+                                 : Interpolate(kept[segment], kept[segment + 1], sample.first);
+            deviation = std::max(deviation, Distance(replayed, sample.second));
+        }
+        return deviation;
+    }
+
+    Point Trajectory::Interpolate(const Sample&from, const Sample&to, float time) {
+        const float span = to.first - from.first;
+        const float t = span <= 0 ? 0 : std::clamp((time - from.first) / span, 0.0f, 1.0f);
+        return {
+            from.second.x + (to.second.x - from.second.x) * t,
+            from.second.y + (to.second.y - from.second.y) * t
+        };
+    }
+
+    float Trajectory::DistanceToLine(const Point&p1, const Point&p2, const Point&p) {
+        float a = p2.y - p1.y;
+        float b = p1.x - p2.x;
+        float length = std::sqrt(a * a + b * b);
+        if (length == 0) {
+            return Distance(p1, p);
+        }
+        float c = -a * p1.x - b * p1.y;
+        return std::abs(a * p.x + b * p.y + c) / length;
+    }
+
+    float Trajectory::Distance(const Point&p1, const Point&p2) {
+        return std::hypot(p2.x - p1.x, p2.y - p1.y);
+    }
+
+    template<typename Metric>
+    std::vector<Trajectory::Sample> Trajectory::douglasPeucker(const std::vector<Sample>&samples, float tolerance,
+                                                               Metric metric) {
+        if (samples.size() < 3) {
+            return samples;
+        }
+        std::vector<bool> keep(samples.size(), false);
+        keep.front() = keep.back() = true;
+        //Explicit stack, long recordings would otherwise recurse once per kept sample
+        std::vector<std::pair<size_t, size_t>> ranges{{0, samples.size() - 1}};
+        while (!ranges.empty()) {
+            auto [first, last] = ranges.back();
+            ranges.pop_back();
+            float farthest = 0;
+            size_t index = first;
+            for (size_t i = first + 1; i < last; i++) {
+                float distance = metric(samples[first], samples[last], samples[i]);
+                if (distance > farthest) {
+                    farthest = distance;
+                    index = i;
+                }
+            }
+            if (farthest > tolerance) {
+                keep[index] = true;
+                ranges.emplace_back(first, index);
+                ranges.emplace_back(index, last);
+            }
+        }
+        std::vector<Sample> result;
+        for (size_t i = 0; i < samples.size(); i++) {
+            if (keep[i]) {
+                result.push_back(samples[i]);
+            }
+        }
+        return result;
+    }
+}
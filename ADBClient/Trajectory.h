@@ -0,0 +1,44 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <utility>
+#include <vector>
+#include "ADBClient.h"
+
+namespace ADBC {
+    //Touch path processing for recorded gestures. Samples are time:point pairs as stored in AndroidEvent::points.
+    class Trajectory {
+    public:
+        using Sample = std::pair<float, Point>;
+
+        //Ramer-Douglas-Peucker on the path shape: drops every sample within tolerance pixels of the line between the
+        //samples kept around it. Endpoints always stay.
+        static std::vector<Sample> Simplify(const std::vector<Sample>&samples, float tolerance);
+
+        //Douglas-Peucker with the synchronized distance: a sample is only dropped if the position interpolated at its
+        //own time between the kept neighbours lies within tolerance. Replaying the result as timed linear segments
+        //therefore stays within tolerance of the recording at every instant, pauses and speed changes included, with
+        //as few segments as the bound allows.
+        static std::vector<Sample> SimplifyTimed(const std::vector<Sample>&samples, float tolerance);
+
+        //Inserts samples so that no segment moves further than maxStep pixels, interpolated in time so speed is kept.
+        //Fast stretches get more samples than slow ones.
+        static std::vector<Sample> Resample(const std::vector<Sample>&samples, float maxStep);
+
+        //Largest synchronized distance between the recording and its replay through the kept samples
+        static float Deviation(const std::vector<Sample>&original, const std::vector<Sample>&kept);
+
+        static Point Interpolate(const Sample&from, const Sample&to, float time);
+
+        static float DistanceToLine(const Point&p1, const Point&p2, const Point&p);
+
+        static float Distance(const Point&p1, const Point&p2);
+
+    private:
+        template<typename Metric>
+        static std::vector<Sample> douglasPeucker(const std::vector<Sample>&samples, float tolerance, Metric metric);
+    };
+}
+
+
+#endif //TRAJECTORY_H
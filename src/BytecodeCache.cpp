@@ -0,0 +1,177 @@
+#include "BytecodeCache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr uint32_t Magic = 0x424f494d; //"MIOB"
+    constexpr uint32_t Version = 1;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t luaVersion;
+        uint32_t size;
+        int64_t mtime;
+        uint64_t hash;
+    };
+
+    int writer(lua_State*, const void* p, size_t size, void* ud) {
+        static_cast<std::string *>(ud)->append(static_cast<const char *>(p), size);
+        return 0;
+    }
+
+    std::string dump(lua_State* L) {
+        std::string bytecode;
+#if LUA_VERSION_NUM >= 503
+        lua_dump(L, writer, &bytecode, 0);
+#else
+        lua_dump(L, writer, &bytecode);
+#endif
+        return bytecode;
+    }
+}
+
+BytecodeCache& BytecodeCache::Instance() {
+    static BytecodeCache instance;
+    return instance;
+}
+
+void BytecodeCache::SetDirectory(const std::string&directory) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->directory = directory;
+}
+
+void BytecodeCache::Clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+}
+
+sol::load_result BytecodeCache::Load(lua_State* L, const std::string&path) {
+    const std::string chunkName = "@" + path;
+    std::error_code ec;
+    const int64_t mtime = fs::last_write_time(path, ec).time_since_epoch().count();
+    const uintmax_t size = fs::file_size(path, ec);
+    const std::string key = fs::absolute(path, ec).lexically_normal().string();
+
+    //Fast path: the entry was verified against a source with the same stamp
+    std::string bytecode; {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key);
+        if (it != entries.end() && it->second.size != 0 && it->second.size == size && it->second.mtime == mtime) {
+            bytecode = it->second.bytecode;
+        }
+    }
+    if (!bytecode.empty()) {
+        int status = luaL_loadbufferx(L, bytecode.data(), bytecode.size(), chunkName.c_str(), "b");
+        if (status == LUA_OK) {
+            return sol::load_result(L, lua_absindex(L, -1), 1, 1, sol::load_status::ok);
+        }
+        lua_pop(L, 1);
+        bytecode.clear();
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        lua_pushstring(L, ("cannot open " + path).c_str());
+        return sol::load_result(L, lua_absindex(L, -1), 1, 1, sol::load_status::file);
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string source = buffer.str();
+    const uint64_t hash = Hash(source); {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key);
+        if (it == entries.end()) {
+            Entry entry;
+            if (readEntry(key, entry)) {
+                it = entries.emplace(key, std::move(entry)).first;
+            }
+        }
+        if (it != entries.end() && it->second.mtime == mtime && it->second.hash == hash) {
+            it->second.size = source.size();
+            bytecode = it->second.bytecode;
+        }
+    }
+
+    if (!bytecode.empty()) {
+        int status = luaL_loadbufferx(L, bytecode.data(), bytecode.size(), chunkName.c_str(), "b");
+        if (status == LUA_OK) {
+            return sol::load_result(L, lua_absindex(L, -1), 1, 1, sol::load_status::ok);
+        }
+        lua_pop(L, 1);
+    }
+
+    int status = luaL_loadbufferx(L, source.data(), source.size(), chunkName.c_str(), "t");
+    if (status == LUA_OK) {
+        Entry entry{mtime, hash, dump(L), source.size()};
+        std::string target; {
+            std::lock_guard<std::mutex> lock(mutex);
+            target = entryPath(key);
+            entries[key] = entry;
+        }
+        writeEntry(target, entry);
+    }
+    return sol::load_result(L, lua_absindex(L, -1), 1, 1, static_cast<sol::load_status>(status));
+}
+
+bool BytecodeCache::readEntry(const std::string&path, Entry&entry) const {
+    std::ifstream file(entryPath(path), std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    Header header{};
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != Magic ||
+        header.version != Version || header.luaVersion != LUA_VERSION_NUM) {
+        return false;
+    }
+    entry.mtime = header.mtime;
+    entry.hash = header.hash;
+    entry.bytecode.resize(header.size);
+    return static_cast<bool>(file.read(entry.bytecode.data(), header.size));
+}
+
+void BytecodeCache::writeEntry(const std::string&target, const Entry&entry) {
+    std::error_code ec;
+    fs::create_directories(fs::path(target).parent_path(), ec);
+    //Per thread, two states compiling the same file may write it at the same time
+    std::stringstream tmp;
+    tmp << target << "." << std::hex << std::hash<std::thread::id>()(std::this_thread::get_id()) << ".tmp";
+    {
+        std::ofstream file(tmp.str(), std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return;
+        }
+        Header header{
+            Magic, Version, LUA_VERSION_NUM, static_cast<uint32_t>(entry.bytecode.size()), entry.mtime, entry.hash
+        };
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(entry.bytecode.data(), entry.bytecode.size());
+    }
+    fs::rename(tmp.str(), target, ec);
+    if (ec) {
+        fs::remove(tmp.str(), ec);
+        std::cerr << "Unable to write bytecode cache: " << target << std::endl;
+    }
+}
+
+std::string BytecodeCache::entryPath(const std::string&path) const {
+    std::stringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << Hash(path) << ".luac";
+    return (fs::path(directory) / ss.str()).string();
+}
+
+uint64_t BytecodeCache::Hash(const std::string&data) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (unsigned char c: data) {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
@@ -0,0 +1,49 @@
+#ifndef BYTECODECACHE_H
+#define BYTECODECACHE_H
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <sol/sol.hpp>
+
+//Process-wide cache of compiled Lua chunks keyed by source path, modification time and content hash.
+//Entries are kept in memory and mirrored to disk, stale or unreadable entries silently fall back to source.
+//Once an entry has been checked against the source, loads with the same modification time and size use it without
+//reading or hashing the source again.
+class BytecodeCache {
+public:
+    static BytecodeCache& Instance();
+
+    sol::load_result Load(lua_State* L, const std::string&path);
+
+    void SetDirectory(const std::string&directory);
+
+    void Clear();
+
+private:
+    struct Entry {
+        int64_t mtime = 0;
+        uint64_t hash = 0;
+        std::string bytecode;
+        //Size of the source the hash was verified against in this process, zero until then
+        uintmax_t size = 0;
+    };
+
+    BytecodeCache() = default;
+
+    bool readEntry(const std::string&path, Entry&entry) const;
+
+    //Runs outside the lock, target comes from entryPath taken under it
+    static void writeEntry(const std::string&target, const Entry&entry);
+
+    std::string entryPath(const std::string&path) const;
+
+    static uint64_t Hash(const std::string&data);
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    std::string directory = "assets/bytecode";
+};
+
+
+#endif //BYTECODECACHE_H
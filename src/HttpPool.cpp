@@ -0,0 +1,190 @@
+#include "HttpPool.h"
+
+#include <cstdio>
+
+namespace {
+    size_t writeString(char* data, size_t size, size_t count, void* ud) {
+        static_cast<std::string *>(ud)->append(data, size * count);
+        return size * count;
+    }
+}
+
+bool HttpPool::Call::Ready() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return ready;
+}
+
+const HttpPool::Response& HttpPool::Call::Get() const {
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return ready; });
+    return response;
+}
+
+void HttpPool::Call::Then(std::function<void(const Response&)> callback) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!ready) {
+            callbacks.push_back(std::move(callback));
+            return;
+        }
+    }
+    callback(response);
+}
+
+void HttpPool::Call::complete(Response response) {
+    std::vector<std::function<void(const Response&)>> pending; {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->response = std::move(response);
+        ready = true;
+        pending.swap(callbacks);
+    }
+    done.notify_all();
+    //The response is immutable once ready, callbacks read it without the lock
+    for (auto&callback: pending) {
+        callback(this->response);
+    }
+}
+
+HttpPool& HttpPool::Instance() {
+    static HttpPool instance(6);
+    return instance;
+}
+
+HttpPool::HttpPool(size_t connections) {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    share = curl_share_init();
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, &HttpPool::lock);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, &HttpPool::unlock);
+    curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    for (size_t i = 0; i < connections; i++) {
+        workers.emplace_back(&HttpPool::worker, this);
+    }
+}
+
+HttpPool::~HttpPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    available.notify_all();
+    for (auto&worker: workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    curl_share_cleanup(share);
+}
+
+std::shared_ptr<HttpPool::Call> HttpPool::Submit(Request request) {
+    auto call = std::make_shared<Call>(); {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stop) {
+            Response response;
+            response.error = "HTTP pool is shutting down";
+            call->complete(std::move(response));
+            return call;
+        }
+        queue.emplace_back(std::move(request), call);
+    }
+    available.notify_one();
+    return call;
+}
+
+size_t HttpPool::Pending() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return queue.size();
+}
+
+void HttpPool::worker() {
+    CURL* curl = curl_easy_init();
+    while (true) {
+        std::pair<Request, std::shared_ptr<Call>> task; {
+            std::unique_lock<std::mutex> lock(mutex);
+            available.wait(lock, [this] { return stop || !queue.empty(); });
+            if (stop && queue.empty()) {
+                break;
+            }
+            task = std::move(queue.front());
+            queue.pop_front();
+        }
+        task.second->complete(perform(curl, task.first));
+    }
+    curl_easy_cleanup(curl);
+}
+
+HttpPool::Response HttpPool::perform(CURL* curl, const Request&request) {
+    Response response;
+    if (curl == nullptr) {
+        response.error = "curl_easy_init failed";
+        return response;
+    }
+    //Reset clears the options but keeps the handle's open connections
+    curl_easy_reset(curl);
+    curl_easy_setopt(curl, CURLOPT_SHARE, share);
+    curl_easy_setopt(curl, CURLOPT_URL, request.url.c_str());
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, request.timeoutMs);
+    if (!request.proxy.empty()) {
+        curl_easy_setopt(curl, CURLOPT_PROXY, request.proxy.c_str());
+    }
+    if (request.method == "POST") {
+        curl_easy_setopt(curl, CURLOPT_POST, 1L);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request.body.data());
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(request.body.size()));
+    }
+    else if (request.method != "GET") {
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, request.method.c_str());
+        if (!request.body.empty()) {
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request.body.data());
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(request.body.size()));
+        }
+    }
+    curl_slist* headers = nullptr;
+    for (const auto&header: request.headers) {
+        headers = curl_slist_append(headers, header.c_str());
+    }
+    if (headers != nullptr) {
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    }
+
+    FILE* file = nullptr;
+    if (!request.savePath.empty()) {
+        file = std::fopen(request.savePath.c_str(), "wb");
+        if (file == nullptr) {
+            curl_slist_free_all(headers);
+            response.error = "cannot open " + request.savePath;
+            return response;
+        }
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, nullptr);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, file);
+    }
+    else {
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &writeString);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response.body);
+    }
+
+    CURLcode code = curl_easy_perform(curl);
+    if (code != CURLE_OK) {
+        response.error = curl_easy_strerror(code);
+    }
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response.status);
+    if (file != nullptr) {
+        std::fclose(file);
+    }
+    curl_slist_free_all(headers);
+    return response;
+}
+
+void HttpPool::lock(CURL*, curl_lock_data data, curl_lock_access, void* ud) {
+    static_cast<HttpPool *>(ud)->shareLocks[data].lock();
+}
+
+void HttpPool::unlock(CURL*, curl_lock_data data, void* ud) {
+    static_cast<HttpPool *>(ud)->shareLocks[data].unlock();
+}
@@ -0,0 +1,92 @@
+#ifndef HTTPPOOL_H
+#define HTTPPOOL_H
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <curl/curl.h>
+
+//Process-wide HTTP client for scripts. A fixed set of workers each keep one curl easy handle alive between requests
+//and share a connection and DNS cache, so repeated calls to the same host reuse keep-alive connections. The number
+//of workers bounds the requests in flight, further submissions wait in a queue.
+class HttpPool {
+public:
+    struct Request {
+        std::string method = "GET";
+        std::string url;
+        std::string body;
+        std::vector<std::string> headers;
+        std::string proxy;
+        //Stream the response body into this file instead of memory
+        std::string savePath;
+        long timeoutMs = 30000;
+    };
+
+    struct Response {
+        long status = 0;
+        std::string body;
+        std::string error;
+
+        bool ok() const {
+            return error.empty() && status >= 200 && status < 300;
+        }
+    };
+
+    //Completion handle of a submitted request, safe to share between threads
+    class Call {
+    public:
+        bool Ready() const;
+
+        //Blocks until the response arrives
+        const Response& Get() const;
+
+        //Runs callback with the response, immediately if it already arrived, otherwise on the pool worker
+        void Then(std::function<void(const Response&)> callback);
+
+    private:
+        friend class HttpPool;
+
+        void complete(Response response);
+
+        mutable std::mutex mutex;
+        mutable std::condition_variable done;
+        bool ready = false;
+        Response response;
+        std::vector<std::function<void(const Response&)>> callbacks;
+    };
+
+    static HttpPool& Instance();
+
+    ~HttpPool();
+
+    std::shared_ptr<Call> Submit(Request request);
+
+    size_t Pending() const;
+
+private:
+    explicit HttpPool(size_t connections);
+
+    void worker();
+
+    Response perform(CURL* curl, const Request&request);
+
+    static void lock(CURL*, curl_lock_data data, curl_lock_access, void* ud);
+
+    static void unlock(CURL*, curl_lock_data data, void* ud);
+
+    std::vector<std::thread> workers;
+    std::deque<std::pair<Request, std::shared_ptr<Call>>> queue;
+    mutable std::mutex mutex;
+    std::condition_variable available;
+    bool stop = false;
+    CURLSH* share = nullptr;
+    std::array<std::mutex, CURL_LOCK_DATA_LAST> shareLocks;
+};
+
+
+#endif //HTTPPOOL_H
@@ -1,5 +1,9 @@
 #include "ImageUtils.h"
 
+#include <bit>
+#include <shared_mutex>
+#include <unordered_map>
+
 #include "utils.h"
 using namespace RC;
 
@@ -23,6 +27,24 @@ cv::Mat ImageUtils::Image(const std::string&srcPath) {
     return cv::imread(srcPath);
 }
 
+cv::Mat ImageUtils::Template(const std::string&srcPath) {
+    static std::shared_mutex mutex;
+    static std::unordered_map<std::string, cv::Mat> templates; {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = templates.find(srcPath);
+        if (it != templates.end()) {
+            return it->second;
+        }
+    }
+    cv::Mat image = cv::imread(srcPath);
+    if (image.empty()) {
+        std::cerr << "Could not open or find the image: " << srcPath << std::endl;
+        return image;
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    return templates.emplace(srcPath, image).first->second;
+}
+
 ADBC::Point ImageUtils::Find(cv::Mat&src, const cv::Mat&templateImage,float thresh) {
     if (src.empty() || templateImage.empty()) {
         std::cerr << "Could not open or find the image" << std::endl;
@@ -102,3 +124,123 @@ ADBC::Point ImageUtils::Match(const std::string&srcPath, const std::string&templ
     cv::Mat templateImage = cv::imread(templatePath);
     return Match(src, templateImage, outputPath);
 }
+
+cv::Mat ImageUtils::Region(const cv::Mat&src, int x, int y, int width, int height) {
+    cv::Rect rect = cv::Rect(x, y, width, height) & cv::Rect(0, 0, src.cols, src.rows);
+    if (rect.empty()) {
+        return {};
+    }
+    return src(rect);
+}
+
+cv::Mat ImageUtils::Resize(const cv::Mat&src, int width, int height, int interpolation) {
+    cv::Mat dst;
+    if (src.empty() || width <= 0 || height <= 0) {
+        return dst;
+    }
+    cv::resize(src, dst, cv::Size(width, height), 0, 0, interpolation);
+    return dst;
+}
+
+cv::Mat ImageUtils::CvtColor(const cv::Mat&src, int code) {
+    cv::Mat dst;
+    if (src.empty()) {
+        return dst;
+    }
+    cv::cvtColor(src, dst, code);
+    return dst;
+}
+
+cv::Mat ImageUtils::Threshold(const cv::Mat&src, double thresh, double maxValue, int type) {
+    cv::Mat dst;
+    if (src.empty()) {
+        return dst;
+    }
+    cv::threshold(src, dst, thresh, maxValue, type);
+    return dst;
+}
+
+cv::Mat ImageUtils::InRange(const cv::Mat&src, const cv::Scalar&lower, const cv::Scalar&upper) {
+    cv::Mat dst;
+    if (src.empty()) {
+        return dst;
+    }
+    cv::inRange(src, lower, upper, dst);
+    return dst;
+}
+
+cv::Mat ImageUtils::AbsDiff(const cv::Mat&src1, const cv::Mat&src2) {
+    cv::Mat dst;
+    if (src1.empty() || src2.empty() || src1.size() != src2.size() || src1.type() != src2.type()) {
+        std::cerr << "AbsDiff: images must have the same size and type" << std::endl;
+        return dst;
+    }
+    cv::absdiff(src1, src2, dst);
+    return dst;
+}
+
+int ImageUtils::CountNonZero(const cv::Mat&src) {
+    if (src.empty()) {
+        return 0;
+    }
+    if (src.channels() == 1) {
+        return cv::countNonZero(src);
+    }
+    //Gray weights round a dim or pure blue pixel down to zero
+    cv::Mat any;
+    for (int c = 0; c < src.channels(); c++) {
+        cv::Mat channel;
+        cv::extractChannel(src, channel, c);
+        if (any.empty()) {
+            any = channel != 0;
+        }
+        else {
+            any |= channel != 0;
+        }
+    }
+    return cv::countNonZero(any);
+}
+
+cv::Scalar ImageUtils::CountNonZeroChannels(const cv::Mat&src) {
+    cv::Scalar counts;
+    for (int c = 0; c < std::min(src.channels(), 4); c++) {
+        cv::Mat channel;
+        cv::extractChannel(src, channel, c);
+        counts[c] = cv::countNonZero(channel);
+    }
+    return counts;
+}
+
+cv::Scalar ImageUtils::Mean(const cv::Mat&src, const cv::Mat&mask) {
+    if (src.empty()) {
+        return {};
+    }
+    return cv::mean(src, mask);
+}
+
+uint64_t ImageUtils::Hash(const cv::Mat&src) {
+    if (src.empty()) {
+        return 0;
+    }
+    cv::Mat gray = src;
+    if (src.channels() != 1) {
+        cv::cvtColor(src, gray, src.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+    }
+    if (gray.depth() != CV_8U) {
+        gray.convertTo(gray, CV_8U);
+    }
+    cv::Mat small;
+    cv::resize(gray, small, cv::Size(9, 8), 0, 0, cv::INTER_AREA);
+    uint64_t hash = 0;
+    for (int y = 0; y < 8; y++) {
+        const uchar* row = small.ptr<uchar>(y);
+        for (int x = 0; x < 8; x++) {
+            hash = hash << 1 | (row[x] < row[x + 1] ? 1 : 0);
+        }
+    }
+    return hash;
+}
+
+int ImageUtils::HashDistance(uint64_t hash1, uint64_t hash2) {
+    return std::popcount(hash1 ^ hash2);
+}
@@ -18,6 +18,9 @@ public:
 
     static cv::Mat Image(const std::string&srcPath);
 
+    //Decoded once per process and shared by every script instance, treat the result as read-only
+    static cv::Mat Template(const std::string&srcPath);
+
     static ADBC::Point Find(cv::Mat&src, const cv::Mat&templateImage,float thresh = 0.5f);
 
     static ADBC::Point Find(const std::string&srcPath, const std::string&templatePath,float thresh = 0.5f);
@@ -25,6 +28,32 @@ public:
     static ADBC::Point Match(cv::Mat&src, const cv::Mat&templateImage, const std::string&outputPath = "assets/tmp.png");
 
     static ADBC::Point Match(const std::string&srcPath, const std::string&templatePath, const std::string&outputPath = "assets/tmp.png");
+
+    //Zero-copy view, the rectangle is clamped to the source bounds
+    static cv::Mat Region(const cv::Mat&src, int x, int y, int width, int height);
+
+    static cv::Mat Resize(const cv::Mat&src, int width, int height, int interpolation = cv::INTER_LINEAR);
+
+    static cv::Mat CvtColor(const cv::Mat&src, int code);
+
+    static cv::Mat Threshold(const cv::Mat&src, double thresh, double maxValue = 255, int type = cv::THRESH_BINARY);
+
+    static cv::Mat InRange(const cv::Mat&src, const cv::Scalar&lower, const cv::Scalar&upper);
+
+    static cv::Mat AbsDiff(const cv::Mat&src1, const cv::Mat&src2);
+
+    //Pixels with any non-zero channel, each channel is tested on its own instead of through a gray conversion
+    static int CountNonZero(const cv::Mat&src);
+
+    //Non-zero count of every channel, up to four
+    static cv::Scalar CountNonZeroChannels(const cv::Mat&src);
+
+    static cv::Scalar Mean(const cv::Mat&src, const cv::Mat&mask = cv::Mat());
+
+    //64-bit difference hash, stable under small scale and brightness changes
+    static uint64_t Hash(const cv::Mat&src);
+
+    static int HashDistance(uint64_t hash1, uint64_t hash2);
 };
 
 
@@ -1,109 +1,97 @@
 #ifndef LOADMANAGER_H
 #define LOADMANAGER_H
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
 #include <string>
-#include <yaml-cpp/yaml.h>
 
 #include "ADBClient.h"
+#include "Reflection.h"
 
-namespace YAML {
-    template<>
-    struct convert<ADBC::AndroidEvent> {
-        static Node encode(const ADBC::AndroidEvent&event) {
-            Node node;
-            node["type"] = event.type;
-            node["points"] = event.points;
-            node["start"] = event.start;
-            node["end"] = event.end;
-            node["duration"] = event.end - event.start;
-            node["id"] = event.id;
-            return node;
-        }
-
-        static bool decode(const Node&node, ADBC::AndroidEvent&event) {
-            event.type = node["type"].as<std::string>();
-            event.points = node["points"].as<std::vector<std::pair<float, ADBC::Point>>>();
-            event.start = node["start"].as<float>();
-            event.end = node["end"].as<float>();
-            event.id = node["id"].as<std::string>();
-            return true;
-        }
-    };
-
-    template<>
-    struct convert<ADBC::Point> {
-        static Node encode(const ADBC::Point&point) {
-            Node node;
-            node["x"] = point.x;
-            node["y"] = point.y;
-            return node;
-        }
-
-        static bool decode(const Node&node, ADBC::Point&point) {
-            point.x = node["x"].as<float>();
-            point.y = node["y"].as<float>();
-            return true;
-        }
-    };
+template<>
+struct Reflection::Describe<ADBC::Point> {
+    static constexpr auto fields = std::make_tuple(
+        field("x", &ADBC::Point::x),
+        field("y", &ADBC::Point::y));
+};
 
-    template<>
-    struct convert<std::vector<ADBC::AndroidEvent>> {
-        static Node encode(const std::vector<ADBC::AndroidEvent>&events) {
-            Node node;
-            for (const auto&event: events) {
-                node.push_back(event);
-            }
-            return node;
-        }
+template<>
+struct Reflection::Describe<ADBC::AndroidEvent> {
+    static constexpr auto fields = std::make_tuple(
+        field("type", &ADBC::AndroidEvent::type),
+        field("points", &ADBC::AndroidEvent::points),
+        field("start", &ADBC::AndroidEvent::start),
+        field("end", &ADBC::AndroidEvent::end),
+        //Derived from start and end, events built in code often leave the member unset
+        property<ADBC::AndroidEvent, float>("duration",
+                                            [](const ADBC::AndroidEvent&event) { return event.end - event.start; },
+                                            [](ADBC::AndroidEvent&event, float) {
+                                                event.duration = event.end - event.start;
+                                            }, Derived),
+        field("id", &ADBC::AndroidEvent::id),
+        field("tracks", &ADBC::AndroidEvent::tracks, OmitEmpty));
+};
 
-        static bool decode(const Node&node, std::vector<ADBC::AndroidEvent>&events) {
-            for (const auto&event: node) {
-                events.push_back(event.as<ADBC::AndroidEvent>());
-            }
-            return true;
-        }
+//Saves and loads reflected types and containers of them, the format follows the extension: .json, .bin for the
+//compact binary encoding, and YAML for .yml/.yaml and anything else
+class LoadManager {
+public:
+    enum class Format {
+        Yaml,
+        Json,
+        Binary,
     };
 
-    template<>
-    struct convert<std::map<std::string, std::vector<ADBC::AndroidEvent>>> {
-        static Node encode(const std::map<std::string, std::vector<ADBC::AndroidEvent>>&events) {
-            Node node;
-            for (const auto&event: events) {
-                node[event.first] = event.second;
-            }
-            return node;
+    static Format FormatOf(const std::string&path) {
+        if (path.ends_with(".json")) {
+            return Format::Json;
         }
+        return path.ends_with(".bin") ? Format::Binary : Format::Yaml;
+    }
 
-        static bool decode(const Node&node, std::map<std::string, std::vector<ADBC::AndroidEvent>>&events) {
-            for (const auto&event: node) {
-                events[event.first.as<std::string>()] = event.second.as<std::vector<ADBC::AndroidEvent>>();
-            }
-            return true;
-        }
-    };
-}
-
-class LoadManager {
-public:
     template<typename T>
     static bool Save(const T&data, const std::string&path) {
-        std::ofstream file(path);
+        const Format format = FormatOf(path);
+        std::ofstream file(path, format == Format::Binary ? std::ios::binary : std::ios::out);
         if (!file.is_open()) {
             return false;
         }
-        file << YAML::convert<T>::encode(data);
+        switch (format) {
+            case Format::Yaml:
+                file << YAML::Node(data);
+                break;
+            case Format::Json:
+                file << nlohmann::json(data).dump(2);
+                break;
+            case Format::Binary:
+                file << Reflection::Binary::Encode(data);
+                break;
+        }
         file.close();
         return true;
     }
 
     template<typename T>
     static T Load(const std::string&path) {
-        std::ifstream file(path);
+        const Format format = FormatOf(path);
+        std::ifstream file(path, format == Format::Binary ? std::ios::binary : std::ios::in);
         if (!file.is_open()) {
             throw std::runtime_error("Unable to open file for loading");
         }
-        YAML::Node node = YAML::Load(file);
-        file.close();
-        return node.as<T>();
+        switch (format) {
+            case Format::Yaml:
+                return YAML::Load(file).as<T>();
+            case Format::Json:
+                return nlohmann::json::parse(file).get<T>();
+            default: {
+                const std::string data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+                T value{};
+                if (!Reflection::Binary::Decode(data, value)) {
+                    throw std::runtime_error("Corrupt binary file " + path);
+                }
+                return value;
+            }
+        }
     }
 };
 
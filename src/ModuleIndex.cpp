@@ -0,0 +1,93 @@
+#include "ModuleIndex.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <mutex>
+
+namespace fs = std::filesystem;
+
+std::shared_ptr<ModuleIndex> ModuleIndex::For(const std::string&root) {
+    static std::mutex registryMutex;
+    static std::unordered_map<std::string, std::shared_ptr<ModuleIndex>> registry;
+    const std::string key = fs::absolute(root).lexically_normal().string();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    auto&index = registry[key];
+    if (!index) {
+        index = std::make_shared<ModuleIndex>(key);
+    }
+    return index;
+}
+
+ModuleIndex::ModuleIndex(std::string root): root(std::move(root)) {
+    Refresh();
+}
+
+std::string ModuleIndex::Find(const std::string&name) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = modules.find(name);
+    if (it == modules.end()) {
+        return "";
+    }
+    return it->second.path;
+}
+
+void ModuleIndex::Refresh() {
+    std::unordered_map<std::string, Module> index;
+    std::vector<fs::path> files;
+    std::error_code ec;
+    for (const auto&entry: fs::recursive_directory_iterator(root, ec)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".lua") {
+            files.push_back(entry.path());
+        }
+    }
+    //Directory iteration order is unspecified, sort so that ties resolve the same way on every platform
+    std::ranges::sort(files);
+    for (const auto&file: files) {
+        auto relative = file.lexically_relative(root);
+        relative.replace_extension();
+        std::vector<std::string> parts;
+        for (const auto&part: relative) {
+            parts.push_back(part.string());
+        }
+        for (size_t depth = 0; depth < parts.size(); depth++) {
+            std::string name;
+            for (size_t i = depth; i < parts.size(); i++) {
+                name += (i == depth ? "" : ".") + parts[i];
+            }
+            auto it = index.find(name);
+            if (it == index.end() || depth < it->second.depth) {
+                index[name] = {file.string(), depth};
+            }
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    modules = std::move(index);
+}
+
+void ModuleIndex::Update(const std::vector<std::string>&changedFiles) {
+    bool stale = false; {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        for (const auto&file: changedFiles) {
+            auto relative = fs::path(file).lexically_relative(root);
+            relative.replace_extension();
+            std::string name;
+            for (const auto&part: relative) {
+                name += (name.empty() ? "" : ".") + part.string();
+            }
+            auto it = modules.find(name);
+            bool indexed = it != modules.end() && it->second.path == file;
+            if (indexed != fs::exists(file)) {
+                stale = true;
+                break;
+            }
+        }
+    }
+    if (stale) {
+        Refresh();
+    }
+}
+
+size_t ModuleIndex::Size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return modules.size();
+}
@@ -0,0 +1,39 @@
+#ifndef MODULEINDEX_H
+#define MODULEINDEX_H
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//Maps Lua module names to files below a scripts root. One index is shared by every Script loaded from the same root.
+//Resolution follows the old package.path order: a pattern closer to the root wins, so for a/b/c.lua the names
+//"a.b.c", "b.c" and "c" are all registered unless a shallower file already claims them.
+class ModuleIndex {
+public:
+    static std::shared_ptr<ModuleIndex> For(const std::string&root);
+
+    explicit ModuleIndex(std::string root);
+
+    std::string Find(const std::string&name) const;
+
+    void Refresh();
+
+    //Rebuilds only when files were added or removed, plain edits keep the index as is
+    void Update(const std::vector<std::string>&changedFiles);
+
+    size_t Size() const;
+
+private:
+    struct Module {
+        std::string path;
+        size_t depth;
+    };
+
+    std::string root;
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, Module> modules;
+};
+
+
+#endif //MODULEINDEX_H
@@ -0,0 +1,256 @@
+#include "Profiler.h"
+
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <nlohmann/json.hpp>
+
+static char RegistryKey;
+//Registry table whose keys are the tables given to Wrap
+static char WrappedKey;
+
+static Profiler* profilerOf(lua_State* L) {
+    lua_pushlightuserdata(L, &RegistryKey);
+    lua_rawget(L, LUA_REGISTRYINDEX);
+    auto* profiler = static_cast<Profiler *>(lua_touserdata(L, -1));
+    lua_pop(L, 1);
+    return profiler;
+}
+
+Profiler::Profiler(lua_State* L): L(L) {
+    lua_pushlightuserdata(L, &RegistryKey);
+    lua_pushlightuserdata(L, this);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+}
+
+Profiler::~Profiler() {
+    Stop();
+    lua_pushlightuserdata(L, &RegistryKey);
+    lua_pushnil(L);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+}
+
+void Profiler::Start(int instructions) {
+    if (running) {
+        return;
+    }
+    running = true;
+    runningCount++;
+    if (stacks.empty() && trace.empty()) {
+        origin = Clock::now();
+    }
+    lastSample = Clock::now();
+    swapWrapped(true);
+    lua_sethook(L, &Profiler::hook, LUA_MASKCOUNT, instructions);
+}
+
+void Profiler::Stop() {
+    if (!running) {
+        return;
+    }
+    running = false;
+    runningCount--;
+    lua_sethook(L, nullptr, 0, 0);
+    swapWrapped(false);
+    natives.clear();
+}
+
+void Profiler::Reset() {
+    stacks.clear();
+    natives.clear();
+    trace.clear();
+    origin = Clock::now();
+}
+
+Profiler* Profiler::active(lua_State* L) {
+    Profiler* profiler = profilerOf(L);
+    return profiler != nullptr && profiler->running ? profiler : nullptr;
+}
+
+void Profiler::hook(lua_State* L, lua_Debug* ar) {
+    Profiler* profiler = active(L);
+    if (profiler == nullptr) {
+        //Coroutines created while profiling inherited the hook, drop it the first time they run afterwards
+        lua_sethook(L, nullptr, 0, 0);
+        return;
+    }
+    if (ar->event == LUA_HOOKCOUNT) {
+        profiler->sample(L, Clock::now());
+    }
+}
+
+int Profiler::timedCall(lua_State* L) {
+    Profiler* profiler = active(L);
+    const int nargs = lua_gettop(L);
+    lua_pushvalue(L, lua_upvalueindex(1));
+    lua_insert(L, 1);
+    if (profiler != nullptr) {
+        profiler->enter(L);
+    }
+    lua_call(L, nargs, LUA_MULTRET);
+    //Stopped or replaced while the call ran if it changed
+    if (profiler != nullptr && profiler == active(L)) {
+        profiler->leave(L);
+    }
+    return lua_gettop(L);
+}
+
+void Profiler::Wrap(sol::table table) {
+    lua_State* L = table.lua_state();
+    lua_pushlightuserdata(L, &WrappedKey);
+    lua_rawget(L, LUA_REGISTRYINDEX);
+    if (!lua_istable(L, -1)) {
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_pushlightuserdata(L, &WrappedKey);
+        lua_pushvalue(L, -2);
+        lua_rawset(L, LUA_REGISTRYINDEX);
+    }
+    //The keys holding functions now, functions set later are left alone
+    table.push(L);
+    lua_newtable(L);
+    for (const auto&[key, value]: table) {
+        if (value.get_type() == sol::type::function) {
+            key.push(L);
+            lua_pushboolean(L, 1);
+            lua_rawset(L, -3);
+        }
+    }
+    lua_rawset(L, -3);
+    lua_pop(L, 1);
+}
+
+void Profiler::swapWrapped(bool timed) {
+    lua_pushlightuserdata(L, &WrappedKey);
+    lua_rawget(L, LUA_REGISTRYINDEX);
+    if (!lua_istable(L, -1)) {
+        lua_pop(L, 1);
+        return;
+    }
+    lua_pushnil(L);
+    while (lua_next(L, -2)) {
+        const int table = lua_gettop(L) - 1;
+        lua_pushnil(L);
+        while (lua_next(L, table + 1)) {
+            lua_pop(L, 1);
+            lua_pushvalue(L, -1);
+            lua_rawget(L, table);
+            const bool wrapped = lua_tocfunction(L, -1) == &Profiler::timedCall;
+            if (timed && !wrapped && lua_isfunction(L, -1)) {
+                lua_pushcclosure(L, &Profiler::timedCall, 1);
+            }
+            else if (!timed && wrapped) {
+                lua_getupvalue(L, -1, 1);
+                lua_remove(L, -2);
+            }
+            lua_pushvalue(L, -2);
+            lua_insert(L, -2);
+            lua_rawset(L, table);
+        }
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
+}
+
+void Profiler::ThreadResumed(lua_State* thread) {
+    if (running && natives.contains(thread)) {
+        leave(thread);
+    }
+}
+
+void Profiler::ThreadFinished(lua_State* thread) {
+    //Bindings that raised an error never left
+    natives.erase(thread);
+}
+
+void Profiler::sample(lua_State* L, Clock::time_point now) {
+    record(stackOf(L), lastSample, now, L);
+    lastSample = now;
+}
+
+void Profiler::enter(lua_State* L) {
+    lua_Debug ar;
+    const char* name = "?";
+    if (lua_getstack(L, 0, &ar) && lua_getinfo(L, "n", &ar) && ar.name != nullptr) {
+        name = ar.name;
+    }
+    auto now = Clock::now();
+    //Charge the Lua time leading up to the call before the native clock starts
+    std::string caller = stackOf(L, 1);
+    record(caller, lastSample, now, L);
+    lastSample = now;
+    natives[L] = {caller + ";[C] " + name, now};
+}
+
+void Profiler::leave(lua_State* L) {
+    auto it = natives.find(L);
+    if (it == natives.end()) {
+        return;
+    }
+    auto now = Clock::now();
+    record(it->second.stack, it->second.start, now, L);
+    natives.erase(it);
+    lastSample = now;
+}
+
+void Profiler::record(const std::string&stack, Clock::time_point start, Clock::time_point end, lua_State* L) {
+    if (stack.empty() || end <= start) {
+        return;
+    }
+    const int64_t duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    stacks[stack] += duration;
+    if (trace.size() < MaxTraceEvents) {
+        auto leaf = stack.substr(stack.rfind(';') == std::string::npos ? 0 : stack.rfind(';') + 1);
+        trace.push_back({
+            std::move(leaf), std::chrono::duration_cast<std::chrono::microseconds>(start - origin).count(), duration,
+            std::hash<lua_State *>()(L)
+        });
+    }
+}
+
+std::string Profiler::stackOf(lua_State* L, int level) {
+    std::vector<std::string> frames;
+    lua_Debug ar;
+    for (int i = level; frames.size() < MaxDepth && lua_getstack(L, i, &ar); i++) {
+        lua_getinfo(L, "Sln", &ar);
+        if (std::strcmp(ar.what, "C") == 0) {
+            frames.push_back(std::string("[C] ") + (ar.name ? ar.name : "?"));
+        }
+        else {
+            frames.push_back(std::string(ar.name ? ar.name : std::strcmp(ar.what, "main") == 0 ? "main" : "?") +
+                             " (" + ar.short_src + ":" + std::to_string(ar.linedefined) + ")");
+        }
+    }
+    std::string stack;
+    for (auto it = frames.rbegin(); it != frames.rend(); ++it) {
+        stack += (stack.empty() ? "" : ";") + *it;
+    }
+    return stack;
+}
+
+bool Profiler::ExportCollapsed(const std::string&path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    for (const auto&[stack, microseconds]: stacks) {
+        file << stack << " " << microseconds << "\n";
+    }
+    return true;
+}
+
+bool Profiler::ExportChromeTrace(const std::string&path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    nlohmann::json events = nlohmann::json::array();
+    for (const auto&event: trace) {
+        events.push_back({
+            {"name", event.name}, {"ph", "X"}, {"ts", event.start}, {"dur", event.duration}, {"pid", 1},
+            {"tid", event.thread}
+        });
+    }
+    file << nlohmann::json{{"traceEvents", events}, {"displayTimeUnit", "ms"}};
+    return true;
+}
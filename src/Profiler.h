@@ -0,0 +1,116 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sol/sol.hpp>
+
+//Sampling profiler for one sol::state. While running, a count hook samples the Lua stack every N instructions and
+//charges the wall time since the previous sample to it. Bindings registered through Timed or Wrap (ImageUtils, adb,
+//eurl ...) are timed as their own [C] frames, including any time they spend awaiting the scheduler; other natives
+//are charged to the Lua code that called them by the next sample. Nothing is installed while stopped: Timed costs
+//one relaxed load when no profiler runs and the tables given to Wrap hold their plain functions.
+//Must be started and stopped from the thread that currently owns the state.
+class Profiler {
+public:
+    explicit Profiler(lua_State* L);
+
+    ~Profiler();
+
+    void Start(int instructions = 1000);
+
+    void Stop();
+
+    bool IsRunning() const {
+        return running;
+    }
+
+    void Reset();
+
+    //One "frame;frame;frame microseconds" line per stack, ready for flamegraph.pl or speedscope
+    bool ExportCollapsed(const std::string&path) const;
+
+    bool ExportChromeTrace(const std::string&path) const;
+
+    //For raw bindings, which may yield to the scheduler. A yielded call stays open until ThreadResumed
+    template<lua_CFunction F>
+    static int Timed(lua_State* L) {
+        if (runningCount.load(std::memory_order_relaxed) == 0) {
+            return F(L);
+        }
+        Profiler* profiler = active(L);
+        if (profiler == nullptr) {
+            return F(L);
+        }
+        profiler->enter(L);
+        const int results = F(L);
+        //Lua 5.1 and LuaJIT return -1 from lua_yield, later versions do not return here at all
+        if (results >= 0) {
+            profiler->leave(L);
+        }
+        return results;
+    }
+
+    //Times every function in table while a profiler runs: Start swaps them for timed closures and Stop puts them
+    //back. The functions must not yield.
+    static void Wrap(sol::table table);
+
+    //Called by the scheduler when a suspended thread continues and when it is released
+    void ThreadResumed(lua_State* thread);
+
+    void ThreadFinished(lua_State* thread);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct NativeCall {
+        std::string stack;
+        Clock::time_point start;
+    };
+
+    struct TraceEvent {
+        std::string name;
+        int64_t start;
+        int64_t duration;
+        size_t thread;
+    };
+
+    static Profiler* active(lua_State* L);
+
+    static void hook(lua_State* L, lua_Debug* ar);
+
+    static int timedCall(lua_State* L);
+
+    //Swaps the functions of every table given to Wrap for timed closures around them, or back
+    void swapWrapped(bool timed);
+
+    void sample(lua_State* L, Clock::time_point now);
+
+    void enter(lua_State* L);
+
+    void leave(lua_State* L);
+
+    void record(const std::string&stack, Clock::time_point start, Clock::time_point end, lua_State* L);
+
+    static std::string stackOf(lua_State* L, int level = 0);
+
+    static constexpr size_t MaxTraceEvents = 200000;
+    static constexpr int MaxDepth = 64;
+
+    //Profilers running in the process, Timed skips the registry lookup while there are none
+    static inline std::atomic<int> runningCount = 0;
+
+    lua_State* L;
+    bool running = false;
+    Clock::time_point origin;
+    Clock::time_point lastSample;
+    std::unordered_map<std::string, int64_t> stacks;
+    //The binding each thread is in, a thread is never inside more than one
+    std::unordered_map<lua_State *, NativeCall> natives;
+    std::vector<TraceEvent> trace;
+};
+
+
+#endif //PROFILER_H
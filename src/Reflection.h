@@ -0,0 +1,393 @@
+#ifndef REFLECTION_H
+#define REFLECTION_H
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <nlohmann/json.hpp>
+#include <yaml-cpp/yaml.h>
+
+//Compile time field lists for plain structs. A type is described once by specializing Reflection::Describe with a
+//constexpr tuple of fields, YAML and JSON conversions and a compact binary encoding are generated from it. Fields are
+//visited in declaration order by a fold over the tuple, so the binary encoding stores no names and does no lookups.
+namespace Reflection {
+    enum Flags : uint8_t {
+        None = 0,
+        OmitEmpty = 1, //Not written to YAML or JSON while empty
+        ReadOnly = 2, //Read from YAML or JSON when present, never written. Kept for migrating older files
+        Derived = 4, //Read-only in the binary encoding: not stored, decoding sets it with a default value for the
+                     //setter to recompute from the fields before it
+    };
+
+    template<typename T, typename M>
+    struct Field {
+        using Value = M;
+
+        const char* name;
+        M T::* member;
+        uint8_t flags;
+
+        const M& get(const T&object) const {
+            return object.*member;
+        }
+
+        void set(T&object, M value) const {
+            object.*member = std::move(value);
+        }
+    };
+
+    //A value reached through accessors, for members that are wrapped or need a setter
+    template<typename T, typename V, typename Get, typename Set>
+    struct Property {
+        using Value = V;
+
+        const char* name;
+        Get getter;
+        Set setter;
+        uint8_t flags;
+
+        V get(const T&object) const {
+            return getter(object);
+        }
+
+        void set(T&object, V value) const {
+            setter(object, std::move(value));
+        }
+    };
+
+    template<typename T, typename M>
+    constexpr auto field(const char* name, M T::* member, uint8_t flags = None) {
+        return Field<T, M>{name, member, flags};
+    }
+
+    template<typename T, typename V, typename Get, typename Set>
+    constexpr auto property(const char* name, Get getter, Set setter, uint8_t flags = None) {
+        return Property<T, V, Get, Set>{name, getter, setter, flags};
+    }
+
+    //Specialize with: static constexpr auto fields = std::make_tuple(field("x", &T::x), ...);
+    template<typename T>
+    struct Describe;
+
+    template<typename T>
+    concept Reflected = requires { Describe<T>::fields; };
+
+    template<typename T, typename F>
+    constexpr void forEach(F&&visit) {
+        std::apply([&](const auto&... fields) { (visit(fields), ...); }, Describe<T>::fields);
+    }
+
+    template<typename V>
+    bool isEmpty(const V&value) {
+        if constexpr (requires { value.empty(); }) {
+            return value.empty();
+        }
+        else {
+            return false;
+        }
+    }
+
+    //Binary encoding: integers as (zigzag) varints, floats as raw little endian bytes, strings and containers
+    //prefixed with their size, reflected types as their fields in order. ReadOnly and Derived fields are left out.
+    class Binary {
+    public:
+        template<typename T>
+        static std::string Encode(const T&value) {
+            std::string out;
+            write(out, value);
+            return out;
+        }
+
+        //Fails on truncated or trailing data
+        template<typename T>
+        static bool Decode(std::string_view data, T&value) {
+            const char* p = data.data();
+            const char* end = p + data.size();
+            return read(p, end, value) && p == end;
+        }
+
+    private:
+        template<typename V>
+        static constexpr bool isPair = requires { typename V::first_type; typename V::second_type; };
+
+        template<typename V>
+        static constexpr bool isMap = requires { typename V::key_type; typename V::mapped_type; };
+
+        template<typename V>
+        struct SharedPtr : std::false_type {
+        };
+
+        template<typename V>
+        struct SharedPtr<std::shared_ptr<V>> : std::true_type {
+        };
+
+        template<typename V>
+        static constexpr bool isSharedPtr = SharedPtr<V>::value;
+
+        static void putVarint(std::string&out, uint64_t value) {
+            while (value >= 0x80) {
+                out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<char>(value));
+        }
+
+        static bool getVarint(const char*&p, const char* end, uint64_t&value) {
+            value = 0;
+            for (int shift = 0; shift < 64 && p < end; shift += 7) {
+                const auto byte = static_cast<uint8_t>(*p++);
+                value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        template<typename V>
+        static void write(std::string&out, const V&value) {
+            if constexpr (Reflected<V>) {
+                forEach<V>([&](const auto&field) {
+                    if (!(field.flags & (ReadOnly | Derived))) {
+                        write(out, field.get(value));
+                    }
+                });
+            }
+            else if constexpr (isSharedPtr<V>) {
+                out.push_back(value ? 1 : 0);
+                if (value) {
+                    write(out, *value);
+                }
+            }
+            else if constexpr (std::is_same_v<V, std::string>) {
+                putVarint(out, value.size());
+                out.append(value);
+            }
+            else if constexpr (std::is_same_v<V, bool>) {
+                out.push_back(value ? 1 : 0);
+            }
+            else if constexpr (std::is_enum_v<V>) {
+                write(out, static_cast<std::underlying_type_t<V>>(value));
+            }
+            else if constexpr (std::is_integral_v<V> && std::is_signed_v<V>) {
+                const auto wide = static_cast<int64_t>(value);
+                putVarint(out, (static_cast<uint64_t>(wide) << 1) ^ static_cast<uint64_t>(wide >> 63));
+            }
+            else if constexpr (std::is_integral_v<V>) {
+                putVarint(out, value);
+            }
+            else if constexpr (std::is_floating_point_v<V>) {
+                out.append(reinterpret_cast<const char *>(&value), sizeof(V));
+            }
+            else if constexpr (isPair<V>) {
+                write(out, value.first);
+                write(out, value.second);
+            }
+            else {
+                putVarint(out, value.size());
+                for (const auto&item: value) {
+                    write(out, item);
+                }
+            }
+        }
+
+        template<typename V>
+        static bool read(const char*&p, const char* end, V&value) {
+            if constexpr (Reflected<V>) {
+                bool ok = true;
+                forEach<V>([&](const auto&field) {
+                    if (ok && !(field.flags & ReadOnly)) {
+                        typename std::decay_t<decltype(field)>::Value item{};
+                        ok = field.flags & Derived || read(p, end, item);
+                        if (ok) {
+                            field.set(value, std::move(item));
+                        }
+                    }
+                });
+                return ok;
+            }
+            else if constexpr (isSharedPtr<V>) {
+                if (p == end) {
+                    return false;
+                }
+                if (*p++ == 0) {
+                    value = nullptr;
+                    return true;
+                }
+                value = std::make_shared<typename V::element_type>();
+                return read(p, end, *value);
+            }
+            else if constexpr (std::is_same_v<V, std::string>) {
+                uint64_t size;
+                if (!getVarint(p, end, size) || size > static_cast<uint64_t>(end - p)) {
+                    return false;
+                }
+                value.assign(p, size);
+                p += size;
+                return true;
+            }
+            else if constexpr (std::is_same_v<V, bool>) {
+                if (p == end) {
+                    return false;
+                }
+                value = *p++ != 0;
+                return true;
+            }
+            else if constexpr (std::is_enum_v<V>) {
+                std::underlying_type_t<V> raw;
+                if (!read(p, end, raw)) {
+                    return false;
+                }
+                value = static_cast<V>(raw);
+                return true;
+            }
+            else if constexpr (std::is_integral_v<V>) {
+                uint64_t raw;
+                if (!getVarint(p, end, raw)) {
+                    return false;
+                }
+                if constexpr (std::is_signed_v<V>) {
+                    value = static_cast<V>(static_cast<int64_t>(raw >> 1) ^ -static_cast<int64_t>(raw & 1));
+                }
+                else {
+                    value = static_cast<V>(raw);
+                }
+                return true;
+            }
+            else if constexpr (std::is_floating_point_v<V>) {
+                if (static_cast<size_t>(end - p) < sizeof(V)) {
+                    return false;
+                }
+                std::memcpy(&value, p, sizeof(V));
+                p += sizeof(V);
+                return true;
+            }
+            else if constexpr (isPair<V>) {
+                return read(p, end, value.first) && read(p, end, value.second);
+            }
+            else {
+                uint64_t size;
+                //Every item takes at least one byte, which bounds the count before anything is allocated
+                if (!getVarint(p, end, size) || size > static_cast<uint64_t>(end - p)) {
+                    return false;
+                }
+                value.clear();
+                if constexpr (isMap<V>) {
+                    for (uint64_t i = 0; i < size; i++) {
+                        std::pair<typename V::key_type, typename V::mapped_type> item;
+                        if (!read(p, end, item)) {
+                            return false;
+                        }
+                        value.insert_or_assign(std::move(item.first), std::move(item.second));
+                    }
+                }
+                else {
+                    value.reserve(size);
+                    for (uint64_t i = 0; i < size; i++) {
+                        typename V::value_type item{};
+                        if (!read(p, end, item)) {
+                            return false;
+                        }
+                        value.push_back(std::move(item));
+                    }
+                }
+                return true;
+            }
+        }
+    };
+}
+
+namespace YAML {
+    template<Reflection::Reflected T>
+    struct convert<T> {
+        static Node encode(const T&value) {
+            Node node;
+            Reflection::forEach<T>([&](const auto&field) {
+                if (field.flags & Reflection::ReadOnly) {
+                    return;
+                }
+                const auto&item = field.get(value);
+                if (!(field.flags & Reflection::OmitEmpty && Reflection::isEmpty(item))) {
+                    node[field.name] = item;
+                }
+            });
+            return node;
+        }
+
+        static bool decode(const Node&node, T&value) {
+            if (!node.IsMap()) {
+                return false;
+            }
+            Reflection::forEach<T>([&](const auto&field) {
+                using Value = typename std::decay_t<decltype(field)>::Value;
+                if (const Node item = node[field.name]; item.IsDefined() && !item.IsNull()) {
+                    field.set(value, item.template as<Value>());
+                }
+            });
+            return true;
+        }
+    };
+
+    template<Reflection::Reflected T>
+    struct convert<std::shared_ptr<T>> {
+        static Node encode(const std::shared_ptr<T>&value) {
+            return value ? convert<T>::encode(*value) : Node(NodeType::Null);
+        }
+
+        static bool decode(const Node&node, std::shared_ptr<T>&value) {
+            value = std::make_shared<T>();
+            return convert<T>::decode(node, *value);
+        }
+    };
+}
+
+namespace nlohmann {
+    template<Reflection::Reflected T>
+    struct adl_serializer<T> {
+        static void to_json(json&j, const T&value) {
+            j = json::object();
+            Reflection::forEach<T>([&](const auto&field) {
+                if (field.flags & Reflection::ReadOnly) {
+                    return;
+                }
+                const auto&item = field.get(value);
+                if (!(field.flags & Reflection::OmitEmpty && Reflection::isEmpty(item))) {
+                    j[field.name] = item;
+                }
+            });
+        }
+
+        static void from_json(const json&j, T&value) {
+            Reflection::forEach<T>([&](const auto&field) {
+                using Value = typename std::decay_t<decltype(field)>::Value;
+                if (auto it = j.find(field.name); it != j.end() && !it->is_null()) {
+                    field.set(value, it->template get<Value>());
+                }
+            });
+        }
+    };
+
+    template<Reflection::Reflected T>
+    struct adl_serializer<std::shared_ptr<T>> {
+        static void to_json(json&j, const std::shared_ptr<T>&value) {
+            if (value) {
+                adl_serializer<T>::to_json(j, *value);
+            }
+            else {
+                j = nullptr;
+            }
+        }
+
+        static void from_json(const json&j, std::shared_ptr<T>&value) {
+            value = std::make_shared<T>();
+            adl_serializer<T>::from_json(j, *value);
+        }
+    };
+}
+
+
+#endif //REFLECTION_H
@@ -0,0 +1,279 @@
+#include "ReplayJournal.h"
+
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr std::array<uint32_t, 256> CrcTable = [] {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = crc & 1 ? 0xedb88320 ^ crc >> 1 : crc >> 1;
+            }
+            table[i] = crc;
+        }
+        return table;
+    }();
+
+    //Record: body length, CRC32 of the body, body
+    constexpr size_t HeaderSize = 8;
+
+    void putU32(std::string&out, uint32_t value) {
+        out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    void putString(std::string&out, const std::string&value) {
+        putU32(out, static_cast<uint32_t>(value.size()));
+        out.append(value);
+    }
+
+    bool getU32(const char*&p, const char* end, uint32_t&value) {
+        if (end - p < 4) {
+            return false;
+        }
+        std::memcpy(&value, p, 4);
+        p += 4;
+        return true;
+    }
+
+    bool getString(const char*&p, const char* end, std::string&value) {
+        uint32_t size;
+        if (!getU32(p, end, size) || static_cast<size_t>(end - p) < size) {
+            return false;
+        }
+        value.assign(p, size);
+        p += size;
+        return true;
+    }
+}
+
+ReplayJournal::ReplayJournal(std::string path): path(std::move(path)) {
+}
+
+ReplayJournal::~ReplayJournal() {
+    if (file != nullptr) {
+        std::fclose(file);
+    }
+}
+
+uint32_t ReplayJournal::Crc32(const char* data, size_t size) {
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < size; i++) {
+        crc = CrcTable[(crc ^ static_cast<uint8_t>(data[i])) & 0xff] ^ crc >> 8;
+    }
+    return crc ^ 0xffffffff;
+}
+
+std::vector<ReplayJournal::Entry> ReplayJournal::Recover() {
+    std::vector<Entry> entries;
+    std::string data;
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (in.is_open()) {
+            data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+    }
+    size_t offset = 0;
+    size_t skipped = 0;
+    while (data.size() - offset >= HeaderSize) {
+        size_t length = intactAt(data, offset);
+        if (length == 0) {
+            //Damaged in place if its length still leads to an intact record, otherwise the torn tail of a crash
+            uint32_t claimed;
+            std::memcpy(&claimed, data.data() + offset, 4);
+            const size_t next = offset + HeaderSize + claimed;
+            if (claimed == 0 || next >= data.size() || data.size() - next < HeaderSize || intactAt(data, next) == 0) {
+                break;
+            }
+            skipped++;
+            offset = next;
+            continue;
+        }
+        const char* p = data.data() + offset + HeaderSize;
+        const char* end = p + length;
+        Entry entry;
+        entry.op = static_cast<Op>(*p++);
+        getString(p, end, entry.device);
+        getString(p, end, entry.name);
+        getString(p, end, entry.target);
+        getString(p, end, entry.blob);
+        entries.push_back(std::move(entry));
+        offset += HeaderSize + length;
+    }
+    if (skipped > 0) {
+        std::cerr << "Replay journal " << path << ": skipped " << skipped << " damaged records" << std::endl;
+    }
+    if (offset != data.size()) {
+        std::cerr << "Replay journal " << path << ": dropping " << data.size() - offset
+                << " bytes of an incomplete record" << std::endl;
+        std::error_code ec;
+        fs::resize_file(path, offset, ec);
+    }
+    size = offset;
+    records = entries.size() + skipped;
+    recovered = true;
+    open("ab");
+    return entries;
+}
+
+size_t ReplayJournal::intactAt(const std::string&data, size_t offset) {
+    uint32_t length, crc;
+    std::memcpy(&length, data.data() + offset, 4);
+    std::memcpy(&crc, data.data() + offset + 4, 4);
+    if (length == 0 || data.size() - offset - HeaderSize < length) {
+        return 0;
+    }
+    const char* p = data.data() + offset + HeaderSize;
+    const char* end = p + length;
+    if (Crc32(p, length) != crc) {
+        return 0;
+    }
+    p++;
+    std::string field;
+    for (int i = 0; i < 4; i++) {
+        if (!getString(p, end, field)) {
+            return 0;
+        }
+    }
+    return length;
+}
+
+bool ReplayJournal::Append(const Entry&entry) {
+    if (!recovered) {
+        std::cerr << "Replay journal " << path << " was not recovered, not appending" << std::endl;
+        return false;
+    }
+    if (file == nullptr && !open("ab")) {
+        return false;
+    }
+    std::string body;
+    body.push_back(static_cast<char>(entry.op));
+    putString(body, entry.device);
+    putString(body, entry.name);
+    putString(body, entry.target);
+    putString(body, entry.blob);
+    std::string record;
+    record.reserve(HeaderSize + body.size());
+    putU32(record, static_cast<uint32_t>(body.size()));
+    putU32(record, Crc32(body.data(), body.size()));
+    record.append(body);
+#ifdef _WIN32
+    const bool ok = std::fwrite(record.data(), 1, record.size(), file) == record.size() && std::fflush(file) == 0 &&
+                    _commit(_fileno(file)) == 0;
+#else
+    const bool ok = std::fwrite(record.data(), 1, record.size(), file) == record.size() && std::fflush(file) == 0 &&
+                    fsync(fileno(file)) == 0;
+#endif
+    if (!ok) {
+        std::cerr << "Failed to append to replay journal " << path << std::endl;
+        rollback();
+        return false;
+    }
+    size += record.size();
+    records++;
+    return true;
+}
+
+void ReplayJournal::rollback() {
+    //Whatever part of the record reached the file would otherwise end up in front of the next one
+    std::fclose(file);
+    file = nullptr;
+    std::error_code ec;
+    fs::resize_file(path, size, ec);
+    if (ec) {
+        std::cerr << "Failed to truncate replay journal " << path << ": " << ec.message() << std::endl;
+    }
+    open("ab");
+}
+
+bool ReplayJournal::Reset() {
+    //Its records would be lost without ever having been applied
+    if (!recovered) {
+        std::cerr << "Replay journal " << path << " was not recovered, not resetting" << std::endl;
+        return false;
+    }
+    if (!open("wb")) {
+        return false;
+    }
+    size = 0;
+    records = 0;
+    return true;
+}
+
+bool ReplayJournal::Drop(uint64_t offset, size_t count) {
+    if (!recovered) {
+        std::cerr << "Replay journal " << path << " was not recovered, not dropping" << std::endl;
+        return false;
+    }
+    if (offset >= size) {
+        return Reset();
+    }
+    std::string tail;
+    {
+        std::ifstream in(path, std::ios::binary);
+        in.seekg(static_cast<std::streamoff>(offset));
+        tail.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    if (tail.size() != size - offset) {
+        std::cerr << "Failed to read replay journal " << path << std::endl;
+        return false;
+    }
+    //Written beside the journal and renamed over it, a crash leaves either journal and both replay fine over the
+    //new snapshot
+    const std::string tmp = path + ".tmp";
+    FILE* out = std::fopen(tmp.c_str(), "wb");
+    if (out == nullptr) {
+        std::cerr << "Failed to open replay journal " << tmp << std::endl;
+        return false;
+    }
+#ifdef _WIN32
+    bool ok = std::fwrite(tail.data(), 1, tail.size(), out) == tail.size() && std::fflush(out) == 0 &&
+              _commit(_fileno(out)) == 0;
+#else
+    bool ok = std::fwrite(tail.data(), 1, tail.size(), out) == tail.size() && std::fflush(out) == 0 &&
+              fsync(fileno(out)) == 0;
+#endif
+    ok = std::fclose(out) == 0 && ok;
+    if (!ok) {
+        std::cerr << "Failed to write replay journal " << tmp << std::endl;
+        return false;
+    }
+    if (file != nullptr) {
+        std::fclose(file);
+        file = nullptr;
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    if (ec) {
+        std::cerr << "Failed to replace replay journal " << path << ": " << ec.message() << std::endl;
+        open("ab");
+        return false;
+    }
+    size -= offset;
+    records -= count;
+    return open("ab");
+}
+
+bool ReplayJournal::open(const char* mode) {
+    if (file != nullptr) {
+        std::fclose(file);
+    }
+    file = std::fopen(path.c_str(), mode);
+    if (file == nullptr) {
+        std::cerr << "Failed to open replay journal " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,74 @@
+#ifndef REPLAYJOURNAL_H
+#define REPLAYJOURNAL_H
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+//Append-only log of replay library changes since the last snapshot. Each record is length prefixed and carries a
+//CRC32 of its body, and is flushed to the disk before Append returns. Recovery keeps every intact record and cuts off
+//a torn tail left by a crash. A damaged record followed by an intact one is skipped on its own, every record carries
+//what it changes in full, so the ones after it still apply.
+class ReplayJournal {
+public:
+    enum class Op : uint8_t {
+        Put = 1,
+        Remove = 2,
+        Rename = 3,
+    };
+
+    struct Entry {
+        Op op;
+        std::string device;
+        std::string name;
+        //New name for Rename
+        std::string target;
+        //Encoded replay for Put
+        std::string blob;
+    };
+
+    explicit ReplayJournal(std::string path);
+
+    ~ReplayJournal();
+
+    //Reads all intact records and opens the journal for appending. Until it has run nothing is appended, reset or
+    //dropped, the file may hold changes that were never read
+    std::vector<Entry> Recover();
+
+    //Nothing of the record is left behind when this fails
+    bool Append(const Entry&entry);
+
+    //Empties the journal once its records are part of a snapshot
+    bool Reset();
+
+    //Drops the first count records, which end at offset, keeping the ones appended while a snapshot was written
+    bool Drop(uint64_t offset, size_t count);
+
+    uint64_t Size() const {
+        return size;
+    }
+
+    size_t Records() const {
+        return records;
+    }
+
+    static uint32_t Crc32(const char* data, size_t size);
+
+private:
+    bool open(const char* mode);
+
+    //Cuts the file back to the last complete record
+    void rollback();
+
+    //Length of the intact record at offset, 0 if there is none
+    static size_t intactAt(const std::string&data, size_t offset);
+
+    std::string path;
+    FILE* file = nullptr;
+    bool recovered = false;
+    uint64_t size = 0;
+    size_t records = 0;
+};
+
+
+#endif //REPLAYJOURNAL_H
@@ -0,0 +1,315 @@
+#include "ReplayRepository.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+ReplayRepository::ReplayRepository(std::string path, size_t capacity): path(path),
+                                                                       capacity(std::max<size_t>(capacity, 1)),
+                                                                       journal(path + ".journal") {
+}
+
+ReplayRepository::~ReplayRepository() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (compactor.joinable()) {
+        compactor.join();
+    }
+}
+
+bool ReplayRepository::Open() {
+    {
+        std::lock_guard<std::mutex> saving(saveMutex);
+        std::lock_guard<std::mutex> lock(mutex);
+        opened = false;
+        index.clear();
+        modified.clear();
+        cache.clear();
+        order.clear();
+        store.Close();
+        if (std::filesystem::exists(path) && !store.Open(path)) {
+            std::cerr << "Replay library " << path << " could not be opened, it is left as it is" << std::endl;
+            return false;
+        }
+        for (const auto&entry: store.Index()) {
+            index[{entry.device, entry.name}] = {entry.device, entry.name, entry.size, entry.events, entry.duration};
+        }
+        const auto entries = journal.Recover();
+        for (const auto&entry: entries) {
+            apply(entry);
+        }
+        if (!entries.empty()) {
+            std::cout << "Recovered " << entries.size() << " replay changes from the journal" << std::endl;
+        }
+        opened = true;
+    }
+    if (!compactor.joinable()) {
+        compactor = std::thread(&ReplayRepository::compactLoop, this);
+    }
+    return true;
+}
+
+std::vector<ReplayRepository::Info> ReplayRepository::List(const std::string&device) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Info> result;
+    for (const auto&[key, info]: index) {
+        if (device.empty() || key.first == device) {
+            result.push_back(info);
+        }
+    }
+    return result;
+}
+
+bool ReplayRepository::Contains(const std::string&device, const std::string&name) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return index.contains({device, name});
+}
+
+ReplayRepository::Events ReplayRepository::Get(const std::string&device, const std::string&name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Key key{device, name};
+    //The snapshot can still hold replays that were removed or renamed since it was written
+    if (!index.contains(key)) {
+        return nullptr;
+    }
+    if (auto it = modified.find(key); it != modified.end()) {
+        return it->second;
+    }
+    if (auto it = cache.find(key); it != cache.end()) {
+        order.splice(order.begin(), order, it->second.second);
+        return it->second.first;
+    }
+    const ReplayStore::Entry* entry = store.Find(device, name);
+    if (entry == nullptr) {
+        return nullptr;
+    }
+    auto events = store.Load(*entry);
+    if (!events) {
+        return nullptr;
+    }
+    auto decoded = std::make_shared<const std::vector<ADBC::AndroidEvent>>(std::move(*events));
+    touch(key, decoded);
+    return decoded;
+}
+
+bool ReplayRepository::Put(const std::string&device, const std::string&name, std::vector<ADBC::AndroidEvent> events) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!opened) {
+        return false;
+    }
+    const Key key{device, name};
+    auto shared = std::make_shared<const std::vector<ADBC::AndroidEvent>>(std::move(events));
+    if (!journal.Append({ReplayJournal::Op::Put, device, name, "", ReplayStore::Encode(*shared)})) {
+        return false;
+    }
+    put(key, std::move(shared));
+    wake.notify_all();
+    return true;
+}
+
+bool ReplayRepository::Remove(const std::string&device, const std::string&name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Key key{device, name};
+    if (!opened || !index.contains(key)) {
+        return false;
+    }
+    if (!journal.Append({ReplayJournal::Op::Remove, device, name, "", ""})) {
+        return false;
+    }
+    remove(key);
+    wake.notify_all();
+    return true;
+}
+
+bool ReplayRepository::Rename(const std::string&device, const std::string&name, const std::string&newName) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Key key{device, name};
+    const Key target{device, newName};
+    if (!opened || !index.contains(key) || index.contains(target)) {
+        return false;
+    }
+    Events events = modified.contains(key) ? modified[key] : cache.contains(key) ? cache[key].first : nullptr;
+    std::string blob;
+    if (events) {
+        blob = ReplayStore::Encode(*events);
+    }
+    else if (const ReplayStore::Entry* entry = store.Find(device, name)) {
+        blob = std::string(store.Raw(*entry));
+    }
+    //The record carries the payload so that replaying it does not depend on what the snapshot holds
+    if (!journal.Append({ReplayJournal::Op::Rename, device, name, newName, blob})) {
+        return false;
+    }
+    return rename(key, target);
+}
+
+bool ReplayRepository::Save() {
+    return save();
+}
+
+size_t ReplayRepository::Cached() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cache.size() + modified.size();
+}
+
+void ReplayRepository::apply(const ReplayJournal::Entry&entry) {
+    const Key key{entry.device, entry.name};
+    switch (entry.op) {
+        case ReplayJournal::Op::Put:
+        case ReplayJournal::Op::Rename: {
+            std::vector<ADBC::AndroidEvent> events;
+            if (!ReplayStore::Decode(entry.blob, events)) {
+                std::cerr << "Skipping undecodable journal record for " << entry.name << std::endl;
+                return;
+            }
+            //Both only ever overwrite, so records already folded into the snapshot can be replayed again
+            put(entry.op == ReplayJournal::Op::Put ? key : Key{entry.device, entry.target},
+                std::make_shared<const std::vector<ADBC::AndroidEvent>>(std::move(events)));
+            if (entry.op == ReplayJournal::Op::Rename) {
+                remove(key);
+            }
+            break;
+        }
+        case ReplayJournal::Op::Remove:
+            remove(key);
+            break;
+    }
+}
+
+void ReplayRepository::put(const Key&key, Events events) {
+    index[key] = {key.first, key.second, 0, static_cast<uint32_t>(events->size()), ReplayStore::Duration(*events)};
+    modified[key] = std::move(events);
+    if (auto it = cache.find(key); it != cache.end()) {
+        order.erase(it->second.second);
+        cache.erase(it);
+    }
+}
+
+void ReplayRepository::remove(const Key&key) {
+    index.erase(key);
+    modified.erase(key);
+    if (auto it = cache.find(key); it != cache.end()) {
+        order.erase(it->second.second);
+        cache.erase(it);
+    }
+}
+
+bool ReplayRepository::rename(const Key&key, const Key&target) {
+    Events events = modified.contains(key) ? modified[key] : cache.contains(key) ? cache[key].first : nullptr;
+    if (!events) {
+        const ReplayStore::Entry* entry = store.Find(key.first, key.second);
+        auto loaded = entry != nullptr ? store.Load(*entry) : std::nullopt;
+        if (!loaded) {
+            return false;
+        }
+        events = std::make_shared<const std::vector<ADBC::AndroidEvent>>(std::move(*loaded));
+    }
+    put(target, std::move(events));
+    remove(key);
+    return true;
+}
+
+bool ReplayRepository::save() {
+    //One snapshot at a time, readers and writers only wait for the copy below and for the rename
+    std::lock_guard<std::mutex> saving(saveMutex);
+    std::vector<ReplayStore::Record> records;
+    std::vector<std::pair<size_t, Events>> pending;
+    uint64_t offset;
+    size_t count;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!opened) {
+            return false;
+        }
+        if (journal.Records() == 0 && store.IsOpen()) {
+            return true;
+        }
+        records.reserve(index.size());
+        for (const auto&[key, info]: index) {
+            if (auto it = modified.find(key); it != modified.end()) {
+                pending.emplace_back(records.size(), it->second);
+                records.push_back({key.first, key.second, "", info.events, info.duration});
+            }
+            else if (const ReplayStore::Entry* entry = store.Find(key.first, key.second)) {
+                //Copied out of the mapping, which has to be released before the file can be replaced
+                records.push_back({key.first, key.second, std::string(store.Raw(*entry)), info.events, info.duration});
+            }
+        }
+        offset = journal.Size();
+        count = journal.Records();
+    }
+    for (auto&[i, events]: pending) {
+        records[i].blob = ReplayStore::Encode(*events);
+    }
+    const std::string tmp = path + ".tmp";
+    if (!ReplayStore::Write(records, tmp)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    store.Close();
+    if (!ReplayStore::Replace(tmp, path)) {
+        store.Open(path);
+        return false;
+    }
+    if (!store.Open(path)) {
+        return false;
+    }
+    //Saved recordings become ordinary cache entries instead of staying pinned, unless they changed meanwhile
+    for (auto&[i, events]: pending) {
+        const Key key{records[i].device, records[i].name};
+        if (auto it = modified.find(key); it != modified.end() && it->second == events) {
+            modified.erase(it);
+            touch(key, std::move(events));
+        }
+    }
+    for (const auto&entry: store.Index()) {
+        const Key key{entry.device, entry.name};
+        if (auto it = index.find(key); it != index.end() && !modified.contains(key)) {
+            it->second.size = entry.size;
+        }
+    }
+    //Only once the snapshot is in place, a crash before this replays the journal over it again. Records appended
+    //while it was written are kept
+    journal.Drop(offset, count);
+    return true;
+}
+
+void ReplayRepository::compactLoop() {
+    std::chrono::seconds retry{0};
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        if (retry.count() > 0) {
+            //Back off after a failed save instead of retrying on every change
+            wake.wait_for(lock, retry, [this] { return stopping; });
+        }
+        else {
+            wake.wait_for(lock, std::chrono::seconds(30), [this] {
+                return stopping || journal.Size() >= CompactBytes || journal.Records() >= CompactRecords;
+            });
+        }
+        if (stopping || journal.Records() == 0) {
+            continue;
+        }
+        lock.unlock();
+        const bool saved = save();
+        lock.lock();
+        retry = saved ? std::chrono::seconds(0) : std::min(std::max(retry * 2, CompactRetry), CompactRetryMax);
+    }
+}
+
+void ReplayRepository::touch(const Key&key, Events events) {
+    if (auto it = cache.find(key); it != cache.end()) {
+        order.erase(it->second.second);
+        cache.erase(it);
+    }
+    order.push_front(key);
+    cache[key] = {std::move(events), order.begin()};
+    while (cache.size() > capacity) {
+        cache.erase(order.back());
+        order.pop_back();
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef REPLAYREPOSITORY_H
+#define REPLAYREPOSITORY_H
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ReplayJournal.h"
+#include "ReplayStore.h"
+
+//The replay library as an index kept in memory and payloads decoded on demand. Decoded replays stay in a small LRU,
+//recordings that were added since the last save are pinned until they are written. Safe to use from any thread.
+//Every change is appended to a journal next to the snapshot before it returns, so a crash loses nothing. A background
+//thread folds the journal into a new snapshot once it grows, writing it without holding up readers or writers.
+class ReplayRepository {
+public:
+    using Events = std::shared_ptr<const std::vector<ADBC::AndroidEvent>>;
+
+    struct Info {
+        std::string device;
+        std::string name;
+        uint64_t size;
+        uint32_t events;
+        float duration;
+    };
+
+    explicit ReplayRepository(std::string path, size_t capacity = 8);
+
+    ~ReplayRepository();
+
+    //Reads the index and replays the journal on top of it, a missing file is an empty library. Until it succeeds every
+    //change and Save fail, so a snapshot that could not be read is never overwritten nor its journal emptied
+    bool Open();
+
+    std::vector<Info> List(const std::string&device = "") const;
+
+    bool Contains(const std::string&device, const std::string&name) const;
+
+    //Decodes the replay if it is not cached, nullptr if it does not exist
+    Events Get(const std::string&device, const std::string&name);
+
+    //Changes fail without touching the library if they cannot be journaled
+    bool Put(const std::string&device, const std::string&name, std::vector<ADBC::AndroidEvent> events);
+
+    bool Remove(const std::string&device, const std::string&name);
+
+    //Fails if the replay does not exist or the new name is taken
+    bool Rename(const std::string&device, const std::string&name, const std::string&newName);
+
+    //Writes a new snapshot and empties the journal, untouched replays are copied over without being decoded
+    bool Save();
+
+    size_t Cached() const;
+
+private:
+    using Key = std::pair<std::string, std::string>;
+
+    //Journal size that triggers a background compaction
+    static constexpr uint64_t CompactBytes = 4 << 20;
+    static constexpr size_t CompactRecords = 256;
+    //Wait after a failed compaction, doubled up to the maximum while it keeps failing
+    static constexpr std::chrono::seconds CompactRetry{30};
+    static constexpr std::chrono::seconds CompactRetryMax{600};
+
+    void touch(const Key&key, Events events);
+
+    void apply(const ReplayJournal::Entry&entry);
+
+    void put(const Key&key, Events events);
+
+    void remove(const Key&key);
+
+    bool rename(const Key&key, const Key&target);
+
+    bool save();
+
+    void compactLoop();
+
+    std::string path;
+    size_t capacity;
+    mutable std::mutex mutex;
+    //Held for a whole save, taken before mutex
+    std::mutex saveMutex;
+    ReplayStore store;
+    std::map<Key, Info> index;
+    std::map<Key, Events> modified;
+    std::list<Key> order;
+    std::map<Key, std::pair<Events, std::list<Key>::iterator>> cache;
+    ReplayJournal journal;
+    bool opened = false;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread compactor;
+};
+
+
+#endif //REPLAYREPOSITORY_H
@@ -0,0 +1,561 @@
+#include "ReplayStore.h"
+
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "LoadManager.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+    //Flushes a written file to the disk, ofstream::close only hands it to the OS
+    bool syncFile(const std::string&path) {
+#ifdef _WIN32
+        HANDLE handle = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                    FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (handle == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        const bool ok = FlushFileBuffers(handle);
+        CloseHandle(handle);
+        return ok;
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        const bool ok = fsync(fd) == 0;
+        ::close(fd);
+        return ok;
+#endif
+    }
+
+    //Makes a rename durable, without it a power loss can bring back the old directory entry
+    void syncDirectory(const fs::path&file) {
+#ifndef _WIN32
+        const fs::path dir = file.has_parent_path() ? file.parent_path() : fs::path(".");
+        const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+        if (fd >= 0) {
+            fsync(fd);
+            ::close(fd);
+        }
+#endif
+    }
+
+    enum TypeCode : uint8_t {
+        Tap,
+        Swipe,
+        Multi,
+        Named, //Any other type, spelled out in the strings column
+    };
+
+    enum Column {
+        Types,
+        Strings,
+        Starts,
+        Lengths,
+        Counts,
+        Times,
+        Xs,
+        Ys,
+        Columns
+    };
+
+    constexpr double TimeScale = 1e6;
+    constexpr float PointScale = 8;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t indexOffset;
+        uint64_t indexSize;
+    };
+
+    void putVarint(std::string&out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    void putSigned(std::string&out, int64_t value) {
+        putVarint(out, static_cast<uint64_t>(value) << 1 ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void putString(std::string&out, std::string_view value) {
+        putVarint(out, value.size());
+        out.append(value);
+    }
+
+    class Reader {
+    public:
+        explicit Reader(std::string_view data = {}): p(data.data()), end(data.data() + data.size()) {
+        }
+
+        bool Varint(uint64_t&value) {
+            value = 0;
+            for (int shift = 0; shift < 64 && p < end; shift += 7) {
+                const auto byte = static_cast<uint8_t>(*p++);
+                value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool Signed(int64_t&value) {
+            uint64_t raw;
+            if (!Varint(raw)) {
+                return false;
+            }
+            value = static_cast<int64_t>(raw >> 1) ^ -static_cast<int64_t>(raw & 1);
+            return true;
+        }
+
+        bool Bytes(size_t size, std::string_view&value) {
+            if (static_cast<size_t>(end - p) < size) {
+                return false;
+            }
+            value = std::string_view(p, size);
+            p += size;
+            return true;
+        }
+
+        bool String(std::string&value) {
+            uint64_t size;
+            std::string_view bytes;
+            if (!Varint(size) || !Bytes(size, bytes)) {
+                return false;
+            }
+            value.assign(bytes);
+            return true;
+        }
+
+        template<typename T>
+        bool Fixed(T&value) {
+            std::string_view bytes;
+            if (!Bytes(sizeof(T), bytes)) {
+                return false;
+            }
+            std::memcpy(&value, bytes.data(), sizeof(T));
+            return true;
+        }
+
+        size_t Remaining() const {
+            return static_cast<size_t>(end - p);
+        }
+
+    private:
+        const char* p;
+        const char* end;
+    };
+
+    int64_t toTime(float seconds) {
+        return std::llround(static_cast<double>(seconds) * TimeScale);
+    }
+
+    float fromTime(int64_t time) {
+        return static_cast<float>(static_cast<double>(time) / TimeScale);
+    }
+}
+
+class ReplayStore::MappedFile {
+public:
+    ~MappedFile() {
+#ifdef _WIN32
+        if (data != nullptr) UnmapViewOfFile(data);
+        if (mapping != nullptr) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+        if (data != nullptr) munmap(const_cast<char *>(data), size);
+        if (fd != -1) close(fd);
+#endif
+    }
+
+    bool Open(const std::string&path) {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+        LARGE_INTEGER length;
+        if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &length) || length.QuadPart == 0) {
+            return false;
+        }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            return false;
+        }
+        data = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        size = static_cast<size_t>(length.QuadPart);
+#else
+        fd = open(path.c_str(), O_RDONLY);
+        struct stat st{};
+        if (fd == -1 || fstat(fd, &st) != 0 || st.st_size == 0) {
+            return false;
+        }
+        size = static_cast<size_t>(st.st_size);
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        data = mapped == MAP_FAILED ? nullptr : static_cast<const char *>(mapped);
+#endif
+        return data != nullptr;
+    }
+
+    std::string_view Data() const {
+        return {data, size};
+    }
+
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+ReplayStore::ReplayStore() = default;
+
+ReplayStore::~ReplayStore() = default;
+
+bool ReplayStore::Open(const std::string&path) {
+    Close();
+    auto mapped = std::make_unique<MappedFile>();
+    if (!mapped->Open(path)) {
+        std::cerr << "Failed to map replay store " << path << std::endl;
+        return false;
+    }
+    std::string_view data = mapped->Data();
+    Header header{};
+    if (data.size() < sizeof(Header)) {
+        std::cerr << "Replay store is truncated: " << path << std::endl;
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(Header));
+    if (header.magic != Magic || header.version != Version || header.indexOffset > data.size() ||
+        header.indexSize > data.size() - header.indexOffset) {
+        std::cerr << "Not a replay store or unsupported version: " << path << std::endl;
+        return false;
+    }
+
+    Reader reader(data.substr(header.indexOffset, header.indexSize));
+    uint64_t count;
+    if (!reader.Varint(count)) {
+        return false;
+    }
+    std::vector<Entry> entries;
+    entries.reserve(count);
+    for (uint64_t i = 0; i < count; i++) {
+        Entry entry;
+        uint64_t events;
+        if (!reader.String(entry.device) || !reader.String(entry.name) || !reader.Varint(entry.offset) ||
+            !reader.Varint(entry.size) || !reader.Varint(events) || !reader.Fixed(entry.duration) ||
+            entry.offset > data.size() || entry.size > data.size() - entry.offset) {
+            std::cerr << "Corrupt replay store index: " << path << std::endl;
+            return false;
+        }
+        entry.events = static_cast<uint32_t>(events);
+        entries.push_back(std::move(entry));
+    }
+    file = std::move(mapped);
+    index = std::move(entries);
+    return true;
+}
+
+void ReplayStore::Close() {
+    file.reset();
+    index.clear();
+}
+
+bool ReplayStore::IsOpen() const {
+    return file != nullptr;
+}
+
+const ReplayStore::Entry* ReplayStore::Find(const std::string&device, const std::string&name) const {
+    for (const auto&entry: index) {
+        if (entry.device == device && entry.name == name) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+std::optional<std::vector<ADBC::AndroidEvent>> ReplayStore::Load(const Entry&entry) const {
+    if (!file) {
+        return std::nullopt;
+    }
+    std::vector<ADBC::AndroidEvent> events;
+    if (!Decode(Raw(entry), events)) {
+        std::cerr << "Corrupt replay " << entry.device << "/" << entry.name << std::endl;
+        return std::nullopt;
+    }
+    return events;
+}
+
+ReplayStore::Library ReplayStore::LoadAll() const {
+    Library library;
+    for (const auto&entry: index) {
+        if (auto events = Load(entry)) {
+            library[entry.device][entry.name] = std::move(*events);
+        }
+    }
+    return library;
+}
+
+ReplayStore::Record ReplayStore::Record::From(const std::string&device, const std::string&name,
+                                              const std::vector<ADBC::AndroidEvent>&events) {
+    return {device, name, Encode(events), static_cast<uint32_t>(events.size()), Duration(events)};
+}
+
+std::string_view ReplayStore::Raw(const Entry&entry) const {
+    return file ? file->Data().substr(entry.offset, entry.size) : std::string_view{};
+}
+
+bool ReplayStore::Save(const Library&library, const std::string&path) {
+    std::vector<Record> records;
+    for (const auto&[device, replays]: library) {
+        for (const auto&[name, events]: replays) {
+            records.push_back(Record::From(device, name, events));
+        }
+    }
+    return Save(records, path);
+}
+
+bool ReplayStore::Save(const std::vector<Record>&records, const std::string&path) {
+    //The snapshot has to be on the disk before it replaces the old one, callers drop their journal afterwards
+    const std::string tmp = path + ".tmp";
+    return Write(records, tmp) && Replace(tmp, path);
+}
+
+bool ReplayStore::Write(const std::vector<Record>&records, const std::string&path) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Failed to write replay store " << path << std::endl;
+        return false;
+    }
+    Header header{Magic, Version, 0, 0};
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    uint64_t offset = sizeof(header);
+    std::string indexData;
+    putVarint(indexData, records.size());
+    for (const auto&record: records) {
+        out.write(record.blob.data(), static_cast<std::streamsize>(record.blob.size()));
+        putString(indexData, record.device);
+        putString(indexData, record.name);
+        putVarint(indexData, offset);
+        putVarint(indexData, record.blob.size());
+        putVarint(indexData, record.events);
+        indexData.append(reinterpret_cast<const char *>(&record.duration), sizeof(record.duration));
+        offset += record.blob.size();
+    }
+    out.write(indexData.data(), static_cast<std::streamsize>(indexData.size()));
+    header.indexOffset = offset;
+    header.indexSize = indexData.size();
+    out.seekp(0);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.close();
+    if (!out || !syncFile(path)) {
+        std::cerr << "Failed to write replay store " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ReplayStore::Replace(const std::string&from, const std::string&to) {
+#ifdef _WIN32
+    if (!MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        std::cerr << "Failed to replace replay store " << to << ": error " << GetLastError() << std::endl;
+        return false;
+    }
+#else
+    std::error_code ec;
+    fs::rename(from, to, ec);
+    if (ec) {
+        std::cerr << "Failed to replace replay store " << to << ": " << ec.message() << std::endl;
+        return false;
+    }
+    syncDirectory(to);
+#endif
+    return true;
+}
+
+bool ReplayStore::ImportYaml(const std::string&yamlPath, const std::string&path) {
+    try {
+        return Save(LoadManager::Load<Library>(yamlPath), path);
+    }
+    catch (const std::exception&e) {
+        std::cerr << "Failed to import " << yamlPath << ": " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool ReplayStore::ExportYaml(const std::string&path, const std::string&yamlPath) {
+    ReplayStore store;
+    if (!store.Open(path)) {
+        return false;
+    }
+    return LoadManager::Save(store.LoadAll(), yamlPath);
+}
+
+std::string ReplayStore::Encode(const std::vector<ADBC::AndroidEvent>&events) {
+    std::string columns[Columns];
+    int64_t previousStart = 0;
+    for (const auto&event: events) {
+        TypeCode code = event.type == "tap"
+                            ? Tap
+                            : event.type == "swipe"
+                                  ? Swipe
+                                  : event.type == "multi"
+                                        ? Multi
+                                        : Named;
+        columns[Types].push_back(static_cast<char>(code));
+        if (code == Named) {
+            putString(columns[Strings], event.type);
+        }
+        putString(columns[Strings], event.id);
+        const int64_t start = toTime(event.start);
+        putSigned(columns[Starts], start - previousStart);
+        putSigned(columns[Lengths], toTime(event.end) - start);
+        previousStart = start;
+
+        auto sequence = [&columns, start](const std::vector<std::pair<float, ADBC::Point>>&points) {
+            putVarint(columns[Counts], points.size());
+            int64_t time = start, x = 0, y = 0;
+            for (const auto&[t, p]: points) {
+                const int64_t nextTime = toTime(t);
+                const int64_t nextX = std::llround(p.x * PointScale);
+                const int64_t nextY = std::llround(p.y * PointScale);
+                putSigned(columns[Times], nextTime - time);
+                putSigned(columns[Xs], nextX - x);
+                putSigned(columns[Ys], nextY - y);
+                time = nextTime;
+                x = nextX;
+                y = nextY;
+            }
+        };
+        putVarint(columns[Counts], event.tracks.size());
+        sequence(event.points);
+        for (const auto&track: event.tracks) {
+            sequence(track);
+        }
+    }
+
+    std::string blob;
+    putVarint(blob, events.size());
+    for (const auto&column: columns) {
+        putVarint(blob, column.size());
+    }
+    for (const auto&column: columns) {
+        blob.append(column);
+    }
+    return blob;
+}
+
+bool ReplayStore::Decode(std::string_view blob, std::vector<ADBC::AndroidEvent>&events) {
+    Reader header(blob);
+    uint64_t count;
+    uint64_t sizes[Columns];
+    if (!header.Varint(count)) {
+        return false;
+    }
+    for (auto&size: sizes) {
+        if (!header.Varint(size)) {
+            return false;
+        }
+    }
+    Reader columns[Columns];
+    for (int i = 0; i < Columns; i++) {
+        std::string_view column;
+        if (!header.Bytes(sizes[i], column)) {
+            return false;
+        }
+        columns[i] = Reader(column);
+    }
+
+    auto sequence = [&columns](int64_t start, std::vector<std::pair<float, ADBC::Point>>&points) {
+        uint64_t size;
+        //Every point takes at least a byte of each column, which bounds corrupt counts before anything is allocated
+        if (!columns[Counts].Varint(size) || size > columns[Times].Remaining()) {
+            return false;
+        }
+        points.reserve(size);
+        int64_t time = start, x = 0, y = 0;
+        for (uint64_t i = 0; i < size; i++) {
+            int64_t dt, dx, dy;
+            if (!columns[Times].Signed(dt) || !columns[Xs].Signed(dx) || !columns[Ys].Signed(dy)) {
+                return false;
+            }
+            time += dt;
+            x += dx;
+            y += dy;
+            points.emplace_back(fromTime(time), ADBC::Point{x / PointScale, y / PointScale});
+        }
+        return true;
+    };
+
+    events.clear();
+    if (count > columns[Types].Remaining()) {
+        return false;
+    }
+    events.reserve(count);
+    int64_t start = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        ADBC::AndroidEvent event;
+        uint8_t code;
+        int64_t delta, length;
+        uint64_t tracks;
+        if (!columns[Types].Fixed(code) || (code == Named && !columns[Strings].String(event.type)) ||
+            !columns[Strings].String(event.id) || !columns[Starts].Signed(delta) ||
+            !columns[Lengths].Signed(length) || !columns[Counts].Varint(tracks)) {
+            return false;
+        }
+        if (code != Named) {
+            event.type = code == Tap ? "tap" : code == Swipe ? "swipe" : "multi";
+        }
+        start += delta;
+        event.start = fromTime(start);
+        event.end = fromTime(start + length);
+        event.duration = event.end - event.start;
+        if (!sequence(start, event.points)) {
+            return false;
+        }
+        if (tracks > columns[Counts].Remaining()) {
+            return false;
+        }
+        event.tracks.resize(tracks);
+        for (auto&track: event.tracks) {
+            if (!sequence(start, track)) {
+                return false;
+            }
+        }
+        events.push_back(std::move(event));
+    }
+    return true;
+}
+
+float ReplayStore::Duration(const std::vector<ADBC::AndroidEvent>&events) {
+    if (events.empty()) {
+        return 0;
+    }
+    float first = events.front().start, last = events.front().end;
+    for (const auto&event: events) {
+        first = std::min(first, event.start);
+        last = std::max(last, event.end);
+    }
+    return last - first;
+}
@@ -0,0 +1,101 @@
+#ifndef REPLAYSTORE_H
+#define REPLAYSTORE_H
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ADBClient.h"
+
+//Binary store for recorded replays. Every replay is one blob of structure-of-arrays columns (event types, start
+//and end times, point counts, point times, x, y), times and coordinates delta coded as zigzag varints. Times are kept
+//to the microsecond and coordinates to 1/8 pixel. A name index at the end of the file lets single replays be decoded
+//straight from the memory mapped file.
+class ReplayStore {
+public:
+    using Replays = std::map<std::string, std::vector<ADBC::AndroidEvent>>;
+    //device -> name -> events
+    using Library = std::map<std::string, Replays>;
+
+    struct Entry {
+        std::string device;
+        std::string name;
+        uint64_t offset;
+        uint64_t size;
+        uint32_t events;
+        float duration;
+    };
+
+    //One encoded replay ready to be written
+    struct Record {
+        std::string device;
+        std::string name;
+        std::string blob;
+        uint32_t events;
+        float duration;
+
+        static Record From(const std::string&device, const std::string&name,
+                           const std::vector<ADBC::AndroidEvent>&events);
+    };
+
+    ReplayStore();
+
+    ~ReplayStore();
+
+    //Maps the file and reads its index, payloads are decoded on demand
+    bool Open(const std::string&path);
+
+    void Close();
+
+    bool IsOpen() const;
+
+    const std::vector<Entry>& Index() const {
+        return index;
+    }
+
+    const Entry* Find(const std::string&device, const std::string&name) const;
+
+    std::optional<std::vector<ADBC::AndroidEvent>> Load(const Entry&entry) const;
+
+    Library LoadAll() const;
+
+    //The encoded bytes of a replay inside the mapping, valid until the store is closed
+    std::string_view Raw(const Entry&entry) const;
+
+    //Written to a temporary file and renamed over path
+    static bool Save(const Library&library, const std::string&path);
+
+    static bool Save(const std::vector<Record>&records, const std::string&path);
+
+    //Writes a store file and flushes it to the disk, for callers that replace the old one themselves
+    static bool Write(const std::vector<Record>&records, const std::string&path);
+
+    //Renames from over to and makes the rename durable
+    static bool Replace(const std::string&from, const std::string&to);
+
+    static bool ImportYaml(const std::string&yamlPath, const std::string&path);
+
+    static bool ExportYaml(const std::string&path, const std::string&yamlPath);
+
+    static std::string Encode(const std::vector<ADBC::AndroidEvent>&events);
+
+    //Decodes into events, allocating once per event and track rather than per point
+    static bool Decode(std::string_view blob, std::vector<ADBC::AndroidEvent>&events);
+
+    static float Duration(const std::vector<ADBC::AndroidEvent>&events);
+
+    static constexpr uint32_t Magic = 0x524f494d; //"MIOR"
+    static constexpr uint32_t Version = 1;
+
+private:
+    class MappedFile;
+
+    std::unique_ptr<MappedFile> file;
+    std::vector<Entry> index;
+};
+
+
+#endif //REPLAYSTORE_H
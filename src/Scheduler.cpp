@@ -0,0 +1,294 @@
+#include "Scheduler.h"
+
+thread_local Scheduler::Job* Scheduler::current = nullptr;
+
+static int resumeThread(lua_State* co, int nargs, int&nresults) {
+#if LUA_VERSION_NUM >= 504
+    return lua_resume(co, nullptr, nargs, &nresults);
+#elif LUA_VERSION_NUM >= 502
+    int status = lua_resume(co, nullptr, nargs);
+    nresults = lua_gettop(co);
+    return status;
+#else
+    int status = lua_resume(co, nargs);
+    nresults = lua_gettop(co);
+    return status;
+#endif
+}
+
+Scheduler::Scheduler(size_t workers, size_t ioWorkers): workers(workers), io(ioWorkers) {
+    timerThread = std::thread(&Scheduler::timerLoop, this);
+}
+
+Scheduler::~Scheduler() { {
+        //Under the timer lock so the timer thread cannot miss it between checking and waiting
+        std::lock_guard<std::mutex> lock(timerMutex);
+        cancelled = true;
+    }
+    timerCondition.notify_all(); {
+        std::unique_lock<std::mutex> lock(jobsMutex);
+        jobsCondition.wait(lock, [this] { return jobs.empty(); });
+    } {
+        std::lock_guard<std::mutex> lock(timerMutex);
+        stop = true;
+    }
+    timerCondition.notify_all();
+    timerThread.join();
+}
+
+std::shared_ptr<Scheduler::Job> Scheduler::Spawn(std::shared_ptr<Script> script,
+                                                 std::shared_ptr<ADBC::ADBClient> adbc,
+                                                 const FixedRate&rate, std::function<bool()> running,
+                                                 StageCallback onStage, std::shared_ptr<TickStats> stats) {
+    auto job = std::make_shared<Job>();
+    job->script = std::move(script);
+    job->adbc = std::move(adbc);
+    job->running = std::move(running);
+    job->onStage = std::move(onStage);
+    job->clock = TickClock(rate);
+    if (stats) {
+        job->stats = std::move(stats);
+    } {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        jobs.insert(job);
+    }
+    if (job->onStage) {
+        job->onStage(job->stage);
+    }
+    post(job);
+    return job;
+}
+
+size_t Scheduler::Size() const {
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    return jobs.size();
+}
+
+int Scheduler::Sleep(lua_State* L, int milliseconds) {
+    Job* job = current;
+    if (job == nullptr || job->thread != L || !canYield(L)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+        return 0;
+    }
+    job->sleeping = true;
+    job->wakeAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+    return lua_yield(L, 0);
+}
+
+int Scheduler::AwaitAsync(lua_State* L, std::function<void(Resume)> start) {
+    Job* job = current;
+    if (job == nullptr || job->thread != L || !canYield(L)) {
+        std::promise<Pusher> promise;
+        auto future = promise.get_future();
+        start([&promise](Pusher pusher) { promise.set_value(std::move(pusher)); });
+        return future.get()(L);
+    }
+    job->pendingAsync = std::move(start);
+    return Deferred;
+}
+
+bool Scheduler::canYield(lua_State* L) {
+#if LUA_VERSION_NUM >= 503
+    return lua_isyieldable(L);
+#else
+    bool isMain = lua_pushthread(L) == 1;
+    lua_pop(L, 1);
+    return !isMain;
+#endif
+}
+
+void Scheduler::step(const std::shared_ptr<Job>&job) {
+    if (cancelled && job->stage != Stage::Stopping) {
+        //Shutting down: drop whatever hook was suspended and go straight to OnDestroy
+        finishThread(*job);
+        job->resumeValues = nullptr;
+        job->stage = Stage::Stopping;
+        if (job->onStage) {
+            job->onStage(job->stage);
+        }
+    }
+    int nargs = 0;
+    if (job->thread == nullptr) {
+        if (!startHook(*job)) {
+            advance(job);
+            return;
+        }
+        nargs = lua_gettop(job->thread) - 1;
+    }
+    else {
+        if (job->script->profiler) {
+            //Ends the binding the thread yielded from, its time includes the wait
+            job->script->profiler->ThreadResumed(job->thread);
+        }
+        if (job->resumeValues) {
+            nargs = job->resumeValues(job->thread);
+            job->resumeValues = nullptr;
+        }
+    }
+
+    current = job.get();
+    int nresults = 0;
+    int status = resumeThread(job->thread, nargs, nresults);
+    current = nullptr;
+
+    if (status == LUA_YIELD) {
+        lua_pop(job->thread, nresults);
+        if (job->sleeping) {
+            job->sleeping = false;
+            postAt(job, job->wakeAt);
+        }
+        else if (job->pending) {
+            auto pending = std::move(job->pending);
+            job->pending = nullptr;
+            io.enqueue([this, job, pending = std::move(pending)]() mutable {
+                try {
+                    job->resumeValues = pending();
+                }
+                catch (const std::exception&e) {
+                    std::string message = e.what();
+                    job->resumeValues = [message](lua_State* L) {
+                        lua_pushnil(L);
+                        lua_pushstring(L, message.c_str());
+                        return 2;
+                    };
+                }
+                post(job);
+            });
+        }
+        else if (job->pendingAsync) {
+            auto start = std::move(job->pendingAsync);
+            job->pendingAsync = nullptr;
+            start([this, job](Pusher pusher) {
+                job->resumeValues = std::move(pusher);
+                post(job);
+            });
+        }
+        else {
+            //A bare coroutine.yield() from the script waits one tick interval
+            postAt(job, std::chrono::steady_clock::now() + job->clock.Rate().interval);
+        }
+        return;
+    }
+    if (status != LUA_OK) {
+        const char* message = lua_tostring(job->thread, -1);
+        std::cerr << "Error call function failed in scheduled script: " << (message ? message : "unknown error") <<
+                std::endl;
+    }
+    finishThread(*job);
+    advance(job);
+}
+
+bool Scheduler::startHook(Job&job) {
+    if (job.stage == Stage::Updating && !job.running()) {
+        job.stage = Stage::Stopping;
+        if (job.onStage) {
+            job.onStage(job.stage);
+        }
+    }
+    const char* hook = nullptr;
+    switch (job.stage) {
+        case Stage::Awaking: hook = "Awake";
+            break;
+        case Stage::Starting: hook = "Start";
+            break;
+        case Stage::Updating: hook = "Update";
+            job.dt = job.clock.Begin(std::chrono::steady_clock::now());
+            job.script->ApplyPendingReload();
+            job.script->ApplyPendingProfiler();
+            job.script->SampleMemory();
+            break;
+        case Stage::Stopping: hook = "OnDestroy";
+            break;
+        default: return false;
+    }
+    sol::protected_function* func = job.script->resolve(hook);
+    if (func == nullptr) {
+        return false;
+    }
+    lua_State* L = job.script->lua.lua_state();
+    job.thread = lua_newthread(L);
+    job.threadRef = luaL_ref(L, LUA_REGISTRYINDEX);
+    func->push(job.thread);
+    if (job.stage == Stage::Starting) {
+        sol::stack::push(job.thread, job.adbc);
+    }
+    else if (job.stage == Stage::Updating) {
+        sol::stack::push(job.thread, job.dt);
+    }
+    return true;
+}
+
+void Scheduler::finishThread(Job&job) {
+    if (job.thread == nullptr) {
+        return;
+    }
+    if (job.script->profiler) {
+        job.script->profiler->ThreadFinished(job.thread);
+    }
+    luaL_unref(job.script->lua.lua_state(), LUA_REGISTRYINDEX, job.threadRef);
+    job.thread = nullptr;
+    job.threadRef = LUA_NOREF;
+}
+
+void Scheduler::advance(const std::shared_ptr<Job>&job) {
+    switch (job->stage) {
+        case Stage::Awaking:
+            job->stage = Stage::Starting;
+            break;
+        case Stage::Starting:
+            job->stage = Stage::Updating;
+            job->clock.Reset(std::chrono::steady_clock::now());
+            break;
+        case Stage::Updating:
+            postAt(job, job->clock.End(std::chrono::steady_clock::now(), job->stats.get()));
+            return;
+        case Stage::Stopping:
+            job->stage = Stage::Finished;
+            break;
+        default:
+            break;
+    }
+    if (job->onStage) {
+        job->onStage(job->stage);
+    }
+    if (job->stage == Stage::Finished) { {
+            std::lock_guard<std::mutex> lock(jobsMutex);
+            jobs.erase(job);
+        }
+        jobsCondition.notify_all();
+        return;
+    }
+    post(job);
+}
+
+void Scheduler::post(const std::shared_ptr<Job>&job) {
+    workers.enqueue([this, job] { step(job); });
+}
+
+void Scheduler::postAt(const std::shared_ptr<Job>&job, std::chrono::steady_clock::time_point due) { {
+        std::lock_guard<std::mutex> lock(timerMutex);
+        timers.push({due, job});
+    }
+    timerCondition.notify_one();
+}
+
+void Scheduler::timerLoop() {
+    std::unique_lock<std::mutex> lock(timerMutex);
+    while (!stop) {
+        if (timers.empty()) {
+            timerCondition.wait(lock);
+            continue;
+        }
+        //A copy, a push while the lock is released during the wait may reallocate the queue
+        const auto due = timers.top().due;
+        if (!cancelled && std::chrono::steady_clock::now() < due) {
+            timerCondition.wait_until(lock, due);
+            continue;
+        }
+        auto job = timers.top().job;
+        timers.pop();
+        lock.unlock();
+        post(job);
+        lock.lock();
+    }
+}
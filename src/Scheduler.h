@@ -0,0 +1,159 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_set>
+
+#include "Script.h"
+#include "ThreadPool.h"
+#include "TickClock.h"
+
+//Runs script lifecycles as Lua coroutines on a small worker pool instead of one OS thread per device.
+//Each hook call (Awake, Start, every Update, OnDestroy) is a coroutine. Bindings that would block yield through
+//Await: the blocking part runs on the io pool and the coroutine is resumed with its result once it completes,
+//Sleep parks the coroutine on the timer. Outside of a scheduled coroutine the same bindings simply block.
+class Scheduler {
+public:
+    enum class Stage {
+        Awaking,
+        Starting,
+        Updating,
+        Stopping,
+        Finished,
+    };
+
+    using StageCallback = std::function<void(Stage)>;
+
+    struct Job;
+
+    explicit Scheduler(size_t workers = std::max(2u, std::thread::hardware_concurrency()), size_t ioWorkers = 16);
+
+    //Cancels every job, abandoning the hook in progress, and waits until each has run OnDestroy
+    ~Scheduler();
+
+    std::shared_ptr<Job> Spawn(std::shared_ptr<Script> script, std::shared_ptr<ADBC::ADBClient> adbc,
+                               const FixedRate&rate, std::function<bool()> running,
+                               StageCallback onStage = nullptr, std::shared_ptr<TickStats> stats = nullptr);
+
+    size_t Size() const;
+
+    using Pusher = std::function<int(lua_State*)>;
+    using Resume = std::function<void(Pusher)>;
+
+    //Returned by Await and AwaitAsync when the operation was handed to the job instead of run. The binding has to
+    //let every object with a destructor go out of scope and then return Suspend(L, results): on Lua 5.2+ built as C
+    //lua_yield longjmps out of the C function, past any destructor still pending in its frame.
+    static constexpr int Deferred = -1;
+
+    template<typename F>
+    static int Await(lua_State* L, F&&op);
+
+    //For operations that complete on their own threads: start receives a resume callback to call with a pusher for
+    //the results. Outside of a scheduled coroutine this waits for the callback.
+    static int AwaitAsync(lua_State* L, std::function<void(Resume)> start);
+
+    //Yields for a Deferred operation, passes the number of pushed results through otherwise
+    static int Suspend(lua_State* L, int results) {
+        return results == Deferred ? lua_yield(L, 0) : results;
+    }
+
+    static int Sleep(lua_State* L, int milliseconds);
+
+    struct Job {
+        std::shared_ptr<Script> script;
+        std::shared_ptr<ADBC::ADBClient> adbc;
+        std::function<bool()> running;
+        StageCallback onStage;
+        Stage stage = Stage::Awaking;
+        TickClock clock = TickClock(FixedRate(60));
+        std::shared_ptr<TickStats> stats = std::make_shared<TickStats>();
+        float dt = 0;
+
+        lua_State* thread = nullptr;
+        int threadRef = LUA_NOREF;
+        //Set by a yielding binding, started by the worker once the coroutine is suspended
+        std::function<std::function<int(lua_State*)>()> pending;
+        std::function<void(Resume)> pendingAsync;
+        std::function<int(lua_State*)> resumeValues;
+        std::chrono::steady_clock::time_point wakeAt;
+        bool sleeping = false;
+    };
+
+private:
+    struct Timer {
+        std::chrono::steady_clock::time_point due;
+        std::shared_ptr<Job> job;
+
+        bool operator>(const Timer&other) const {
+            return due > other.due;
+        }
+    };
+
+    void step(const std::shared_ptr<Job>&job);
+
+    bool startHook(Job&job);
+
+    void advance(const std::shared_ptr<Job>&job);
+
+    void finishThread(Job&job);
+
+    void post(const std::shared_ptr<Job>&job);
+
+    void postAt(const std::shared_ptr<Job>&job, std::chrono::steady_clock::time_point due);
+
+    void timerLoop();
+
+    static bool canYield(lua_State* L);
+
+    static thread_local Job* current;
+
+    std::thread timerThread;
+    std::mutex timerMutex;
+    std::condition_variable timerCondition;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<>> timers;
+    bool stop = false;
+    //Set on shutdown: timers fire immediately and no hook but OnDestroy is resumed
+    std::atomic<bool> cancelled = false;
+    mutable std::mutex jobsMutex;
+    std::condition_variable jobsCondition;
+    std::unordered_set<std::shared_ptr<Job>> jobs;
+    //Declared last so they are joined while everything their tasks touch is still alive
+    ThreadPool workers;
+    ThreadPool io;
+};
+
+template<typename F>
+int Scheduler::Await(lua_State* L, F&&op) {
+    using R = std::invoke_result_t<F>;
+    Job* job = current;
+    if (job == nullptr || job->thread != L || !canYield(L)) {
+        if constexpr (std::is_void_v<R>) {
+            op();
+            return 0;
+        }
+        else {
+            return sol::stack::push(L, op());
+        }
+    }
+    job->pending = [op = std::forward<F>(op)]() mutable -> std::function<int(lua_State*)> {
+        if constexpr (std::is_void_v<R>) {
+            op();
+            return [](lua_State*) { return 0; };
+        }
+        else {
+            auto result = std::make_shared<R>(op());
+            return [result](lua_State* L) { return sol::stack::push(L, std::move(*result)); };
+        }
+    };
+    return Deferred;
+}
+
+
+#endif //SCHEDULER_H
@@ -1,9 +1,319 @@
 #include "Script.h"
 
+#include "BytecodeCache.h"
+#include "HttpPool.h"
 #include "LoadManager.h"
+#include "ModuleIndex.h"
+#include "Scheduler.h"
 #include "../MUI/ResourceManager.h"
 
+static cv::Scalar toScalar(const sol::table&values) {
+    return {
+        values.get_or(1, 0.0), values.get_or(2, 0.0), values.get_or(3, 0.0), values.get_or(4, 0.0)
+    };
+}
+
+//Bindings that block on adb, the network or a timer. They yield inside scheduled coroutines and block elsewhere.
+//Everything with a destructor lives in an inner scope that closes before Scheduler::Suspend yields.
+namespace {
+    //Raises a Lua error unless the argument holds a T. luaL_error does not unwind the C++ stack, so every binding
+    //checks its arguments before it creates anything with a destructor.
+    template<typename T>
+    void checkArg(lua_State* L, int index, const char* expected) {
+        if (!sol::stack::check<T>(L, index, sol::no_panic)) {
+            luaL_error(L, "bad argument #%d (%s expected, got %s)", index, expected, luaL_typename(L, index));
+        }
+    }
+
+    template<typename T>
+    void checkOptionalArg(lua_State* L, int index, const char* expected) {
+        if (!lua_isnoneornil(L, index)) {
+            checkArg<T>(L, index, expected);
+        }
+    }
+
+    //Catches adbc.tap(...) written instead of adbc:tap(...)
+    void checkClient(lua_State* L) {
+        checkArg<ADBC::ADBClient>(L, 1, "ADBClient, call it with ':'");
+    }
+
+    //Hashes go to Lua as 16 hex digits, LuaJIT numbers are doubles and would drop the low bits of an int64
+    std::string hashString(uint64_t hash) {
+        char buffer[17];
+        std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+        return buffer;
+    }
+
+    int luaSleep(lua_State* L) {
+        checkArg<int>(L, 1, "number");
+        return Scheduler::Sleep(L, sol::stack::get<int>(L, 1));
+    }
+
+    int luaShell(lua_State* L) {
+        checkClient(L);
+        checkArg<std::string>(L, 2, "string");
+        int results; {
+            auto* client = &sol::stack::get<ADBC::ADBClient&>(L, 1);
+            std::string command = sol::stack::get<std::string>(L, 2);
+            results = Scheduler::Await(L, [client, command] { return client->shell(command); });
+        }
+        return Scheduler::Suspend(L, results);
+    }
+
+    int luaTap(lua_State* L) {
+        checkClient(L);
+        checkArg<ADBC::Point>(L, 2, "Point");
+        checkOptionalArg<float>(L, 3, "number");
+        int results; {
+            auto* client = &sol::stack::get<ADBC::ADBClient&>(L, 1);
+            ADBC::Point p = sol::stack::get<ADBC::Point>(L, 2);
+            float duration = sol::stack::get<sol::optional<float>>(L, 3).value_or(0);
+            results = Scheduler::Await(L, [client, p, duration] { return client->tap(p, duration); });
+        }
+        return Scheduler::Suspend(L, results);
+    }
+
+    int luaSwipe(lua_State* L) {
+        checkClient(L);
+        checkArg<ADBC::Point>(L, 2, "Point");
+        checkArg<ADBC::Point>(L, 3, "Point");
+        checkOptionalArg<float>(L, 4, "number");
+        int results; {
+            auto* client = &sol::stack::get<ADBC::ADBClient&>(L, 1);
+            ADBC::Point start = sol::stack::get<ADBC::Point>(L, 2);
+            ADBC::Point end = sol::stack::get<ADBC::Point>(L, 3);
+            float duration = sol::stack::get<sol::optional<float>>(L, 4).value_or(0);
+            results = Scheduler::Await(L, [client, start, end, duration] {
+                return client->swipe(start, end, duration);
+            });
+        }
+        return Scheduler::Suspend(L, results);
+    }
+
+    int luaText(lua_State* L) {
+        checkClient(L);
+        checkArg<std::string>(L, 2, "string");
+        int results; {
+            auto* client = &sol::stack::get<ADBC::ADBClient&>(L, 1);
+            std::string text = sol::stack::get<std::string>(L, 2);
+            results = Scheduler::Await(L, [client, text] { return client->text(text); });
+        }
+        return Scheduler::Suspend(L, results);
+    }
+
+    int luaInputKey(lua_State* L) {
+        checkClient(L);
+        checkArg<int>(L, 2, "number");
+        int results; {
+            auto* client = &sol::stack::get<ADBC::ADBClient&>(L, 1);
+            auto key = static_cast<ADBC::KeyEvent>(sol::stack::get<int>(L, 2));
+            results = Scheduler::Await(L, [client, key] { return client->inputKey(key); });
+        }
+        return Scheduler::Suspend(L, results);
+    }
+
+    int luaPrintScreen(lua_State* L) {
+        checkClient(L);
+        checkOptionalArg<std::string>(L, 2, "string");
+        int results; {
+            auto* client = &sol::stack::get<ADBC::ADBClient&>(L, 1);
+            std::string destPath = sol::stack::get<sol::optional<std::string>>(L, 2).value_or("assets/screenshot.png");
+            results = Scheduler::Await(L, [client, destPath] { return client->printScreen(destPath); });
+        }
+        return Scheduler::Suspend(L, results);
+    }
+
+    //A replay lasts as long as its recording, it waits on the io pool like any other blocking binding
+    int luaReplayEvents(lua_State* L) {
+        checkClient(L);
+        if (lua_type(L, 2) != LUA_TSTRING) {
+            checkArg<std::vector<ADBC::AndroidEvent>>(L, 2, "events or replay name");
+        }
+        checkOptionalArg<bool>(L, 3, "boolean");
+        int results; {
+            auto* client = &sol::stack::get<ADBC::ADBClient&>(L, 1);
+            //Named replays are looked up here, the event map and source belong to the script's thread
+            std::vector<ADBC::AndroidEvent> events = lua_type(L, 2) == LUA_TSTRING
+                                                         ? client->getEvents(sol::stack::get<std::string>(L, 2))
+                                                         : sol::stack::get<std::vector<ADBC::AndroidEvent>>(L, 2);
+            bool control = sol::stack::get<sol::optional<bool>>(L, 3).value_or(true);
+            results = Scheduler::Await(L, [client, events = std::move(events), control] {
+                return client->ReplayEvents(events, control);
+            });
+        }
+        return Scheduler::Suspend(L, results);
+    }
+
+    int luaImagePrintScreen(lua_State* L) {
+        checkClient(L);
+        int results; {
+            auto adbc = sol::stack::get<std::shared_ptr<ADBC::ADBClient>>(L, 1);
+            results = Scheduler::Await(L, [adbc] { return ImageUtils::PrintScreen(adbc); });
+        }
+        return Scheduler::Suspend(L, results);
+    }
+
+    std::vector<std::string> headerLines(const RequestHeader&header) {
+        std::vector<std::string> lines;
+        auto add = [&lines](const char* name, const std::string&value) {
+            if (!value.empty()) {
+                lines.push_back(std::string(name) + ": " + value);
+            }
+        };
+        add("Content-Type", header.ContentType);
+        add("User-Agent", header.UserAgent);
+        add("Authorization", header.Authorization);
+        add("Accept", header.Accept);
+        add("Host", header.Host);
+        add("Referer", header.Referer);
+        add("Cache-Control", header.CacheControl);
+        add("Connection", header.Connection);
+        return lines;
+    }
+
+    //Body and status on success, nil and the error otherwise
+    int pushBody(lua_State* L, const HttpPool::Response&response) {
+        if (!response.error.empty()) {
+            lua_pushnil(L);
+            sol::stack::push(L, response.error);
+            return 2;
+        }
+        sol::stack::push(L, response.body);
+        lua_pushinteger(L, response.status);
+        return 2;
+    }
+
+    int pushJson(lua_State* L, const HttpPool::Response&response) {
+        if (!response.error.empty()) {
+            lua_pushnil(L);
+            sol::stack::push(L, response.error);
+            return 2;
+        }
+        json body = json::parse(response.body, nullptr, false);
+        if (body.is_discarded()) {
+            sol::stack::push(L, response.body);
+        }
+        else {
+            sol::stack::push(L, body);
+        }
+        lua_pushinteger(L, response.status);
+        return 2;
+    }
+
+    //Hands the call to the job without holding a scheduler thread, the pool worker resumes the coroutine. The
+    //caller suspends once the call and everything else it holds are released.
+    int awaitCall(lua_State* L, std::shared_ptr<HttpPool::Call> call,
+                  int (*push)(lua_State*, const HttpPool::Response&)) {
+        return Scheduler::AwaitAsync(L, [call, push](Scheduler::Resume resume) {
+            call->Then([call, push, resume](const HttpPool::Response&) {
+                resume([call, push](lua_State* L) { return push(L, call->Get()); });
+            });
+        });
+    }
+
+    std::shared_ptr<HttpPool::Call> submitGet(lua_State* L) {
+        HttpPool::Request request;
+        request.url = sol::stack::get<std::string>(L, 1);
+        request.proxy = sol::stack::get<sol::optional<std::string>>(L, 2).value_or("");
+        return HttpPool::Instance().Submit(std::move(request));
+    }
+
+    std::shared_ptr<HttpPool::Call> submitPost(lua_State* L, int proxyIndex) {
+        HttpPool::Request request;
+        request.method = "POST";
+        request.url = sol::stack::get<std::string>(L, 1);
+        request.body = sol::stack::get<std::string>(L, 2);
+        if (auto header = sol::stack::get<sol::optional<RequestHeader>>(L, 3)) {
+            request.headers = headerLines(*header);
+        }
+        request.proxy = sol::stack::get<sol::optional<std::string>>(L, proxyIndex).value_or("");
+        return HttpPool::Instance().Submit(std::move(request));
+    }
+
+    int luaGet(lua_State* L) {
+        checkArg<std::string>(L, 1, "string");
+        checkOptionalArg<std::string>(L, 2, "string");
+        const int results = awaitCall(L, submitGet(L), &pushBody);
+        return Scheduler::Suspend(L, results);
+    }
+
+    int luaPost(lua_State* L) {
+        checkArg<std::string>(L, 1, "string");
+        checkArg<std::string>(L, 2, "string");
+        checkOptionalArg<RequestHeader>(L, 3, "RequestHeader");
+        checkOptionalArg<sol::function>(L, 4, "function");
+        checkOptionalArg<std::string>(L, 5, "string");
+        int results; {
+            //Streaming responses keep going through eurl, everything else shares the pooled connections
+            if (auto callback = sol::stack::get<sol::optional<WriteCallback>>(L, 4); callback && *callback) {
+                std::string url = sol::stack::get<std::string>(L, 1);
+                std::string data = sol::stack::get<std::string>(L, 2);
+                RequestHeader header = sol::stack::get<sol::optional<RequestHeader>>(L, 3).value_or(RequestHeader{});
+                std::string proxy = sol::stack::get<sol::optional<std::string>>(L, 5).value_or("");
+                results = Scheduler::Await(L, [url, data, header, callback = *callback, proxy] {
+                    json response;
+                    eurl::Post(url.c_str(), data, response, header, callback, proxy.c_str());
+                    return response;
+                });
+            }
+            else {
+                results = awaitCall(L, submitPost(L, 5), &pushJson);
+            }
+        }
+        return Scheduler::Suspend(L, results);
+    }
+
+    int luaDownload(lua_State* L) {
+        checkArg<std::string>(L, 1, "string");
+        checkArg<std::string>(L, 2, "string");
+        checkOptionalArg<std::string>(L, 3, "string");
+        int results; {
+            HttpPool::Request request;
+            request.url = sol::stack::get<std::string>(L, 1);
+            request.savePath = sol::stack::get<std::string>(L, 2);
+            request.proxy = sol::stack::get<sol::optional<std::string>>(L, 3).value_or("");
+            request.timeoutMs = 0;
+            results = awaitCall(L, HttpPool::Instance().Submit(std::move(request)),
+                                [](lua_State* L, const HttpPool::Response&response) {
+                                    lua_pushboolean(L, response.ok());
+                                    return 1;
+                                });
+        }
+        return Scheduler::Suspend(L, results);
+    }
+
+    int luaGetAsync(lua_State* L) {
+        checkArg<std::string>(L, 1, "string");
+        checkOptionalArg<std::string>(L, 2, "string");
+        return sol::stack::push(L, submitGet(L));
+    }
+
+    int luaPostAsync(lua_State* L) {
+        checkArg<std::string>(L, 1, "string");
+        checkArg<std::string>(L, 2, "string");
+        checkOptionalArg<RequestHeader>(L, 3, "RequestHeader");
+        checkOptionalArg<std::string>(L, 4, "string");
+        return sol::stack::push(L, submitPost(L, 4));
+    }
+
+    int luaCallAwait(lua_State* L) {
+        checkArg<HttpPool::Call>(L, 1, "HttpCall, call it with ':'");
+        checkOptionalArg<bool>(L, 2, "boolean");
+        int results; {
+            auto call = sol::stack::get<std::shared_ptr<HttpPool::Call>>(L, 1);
+            bool asJson = sol::stack::get<sol::optional<bool>>(L, 2).value_or(false);
+            results = awaitCall(L, call, asJson ? &pushJson : &pushBody);
+        }
+        return Scheduler::Suspend(L, results);
+    }
+}
+
+#ifdef MIO_USE_LUAJIT
+//64-bit LuaJIT refuses custom allocators, memory is reported from the collector instead
 Script::Script() {
+#else
+Script::Script(): lua(sol::default_at_panic, &ScriptAllocator::Alloc, &allocator) {
+#endif
     scriptPath = "";
 }
 
@@ -12,22 +322,34 @@ bool Script::Initialize(std::string scriptsPath) {
         std::cerr << "Scripts directory does not exist!" << std::endl;
         return false;
     }
+    setup(scriptsPath);
+    return loadScript();
+}
+
+bool Script::Initialize(const Script&prototype) {
+    setup(prototype.scriptPath);
+    return loadScript();
+}
+
+void Script::setup(const std::string&scriptsPath) {
     this->scriptPath = scriptsPath;
     binding();
     lua.open_libraries(sol::lib::base, sol::lib::io, sol::lib::math, sol::lib::os, sol::lib::string,
                        sol::lib::table, sol::lib::package, sol::lib::debug, sol::lib::count, sol::lib::coroutine);
+#ifdef MIO_USE_LUAJIT
+    lua.open_libraries(sol::lib::ffi, sol::lib::jit, sol::lib::bit32);
+    registerFFI();
+#endif
     buildPackagePath(scriptsPath);
-    if (!loadScript()) {
-        return false;
-    }
-    return true;
+    installSearcher();
+    lua["Persistent"] = lua.create_table();
 }
 
 sol::protected_function Script::getFunction(const std::string&funcName) {
-    if (checkFunc(funcName)) {
-        sol::protected_function func = lua[funcName];
-        if (func.valid()) {
-            return func;
+    std::lock_guard<std::mutex> lock(invokeMutex);
+    if (sol::protected_function* func = resolve(funcName)) {
+        if (func->valid()) {
+            return *func;
         }
         std::cerr << "Function can not get: " << funcName << std::endl;
         return nullptr;
@@ -38,12 +360,94 @@ sol::protected_function Script::getFunction(const std::string&funcName) {
 
 
 bool Script::checkFunc(const std::string&funcName) {
-    for (const auto&pair: lua.globals()) {
-        if (pair.second.is<sol::function>() && pair.first.as<std::string>() == funcName) {
-            return true;
+    std::lock_guard<std::mutex> lock(invokeMutex);
+    return resolve(funcName) != nullptr;
+}
+
+ScriptAllocator::Stats Script::GetMemoryStats() const {
+#ifdef MIO_USE_LUAJIT
+    return {collectorLive, collectorPeak, 0};
+#else
+    return allocator.GetStats();
+#endif
+}
+
+void Script::SampleMemory() {
+#ifdef MIO_USE_LUAJIT
+    lua_State* L = lua.lua_state();
+    const size_t live = static_cast<size_t>(lua_gc(L, LUA_GCCOUNT, 0)) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+    collectorLive = live;
+    collectorPeak = std::max(collectorPeak.load(), live);
+#endif
+}
+
+void Script::SetMemoryLimit(size_t bytes) {
+#ifdef MIO_USE_LUAJIT
+    std::cerr << "Memory limits need the script allocator, which LuaJIT does not use" << std::endl;
+#else
+    allocator.SetLimit(bytes);
+#endif
+}
+
+void Script::RequestProfiling(bool enable, const std::string&exportPath) {
+    std::lock_guard<std::mutex> lock(profilerMutex);
+    profilerRequest = std::make_pair(enable, exportPath);
+    profilerPending = true;
+}
+
+void Script::ApplyPendingProfiler() {
+    if (!profilerPending) {
+        return;
+    }
+    std::optional<std::pair<bool, std::string>> request; {
+        std::lock_guard<std::mutex> lock(profilerMutex);
+        request.swap(profilerRequest);
+        profilerPending = false;
+    }
+    if (!request) {
+        return;
+    }
+    auto&[enable, exportPath] = *request;
+    if (enable) {
+        if (!profiler) {
+            profiler = std::make_unique<Profiler>(lua.lua_state());
+        }
+        profiler->Reset();
+        profiler->Start();
+    }
+    else if (profiler) {
+        profiler->Stop();
+        if (!exportPath.empty()) {
+            profiler->ExportCollapsed(exportPath + ".folded");
+            profiler->ExportChromeTrace(exportPath + ".json");
         }
     }
-    return false;
+    profiling = profiler && profiler->IsRunning();
+}
+
+void Script::InvalidateFunctions() {
+    functions.clear();
+}
+
+sol::protected_function* Script::resolve(const std::string&funcName) {
+    lua_State* L = lua.lua_state();
+    lua_getglobal(L, funcName.c_str());
+    if (lua_type(L, -1) != LUA_TFUNCTION) {
+        lua_pop(L, 1);
+        functions.erase(funcName);
+        return nullptr;
+    }
+    const void* identity = lua_topointer(L, -1);
+    auto it = functions.find(funcName);
+    if (it != functions.end() && it->second.identity == identity) {
+        lua_pop(L, 1);
+        return &it->second.func;
+    }
+    CachedFunction&cached = functions[funcName];
+    cached.func = sol::protected_function(L, -1);
+    cached.identity = identity;
+    lua_pop(L, 1);
+    return &cached.func;
 }
 
 void Script::PrintAllFunctions() {
@@ -119,31 +523,17 @@ void Script::binding() {
                                    "ContentEncoding", &EntityHeader::ContentEncoding
     );
     auto Eurl = lua.create_table("eurl");
-    Eurl.set_function("Get", [](const char* url,
-                                const sol::optional<std::string>&proxy) -> std::string {
-        std::string response;
-        bool result = eurl::Get(url, response, proxy.value_or("").c_str());
-        return response;
-    });
-    Eurl.set_function("Post", [](const char* url, std::string data, RequestHeader header,
-                                 sol::optional<WriteCallback> callback,
-                                 const sol::optional<std::string>&proxy) -> nlohmann::json {
-        json response;
-        bool result = eurl::Post(url, data, response, header, callback.value_or(nullptr),
-                                 proxy.value_or("").c_str());
-
-        return response;
-    });
-    Eurl.set_function("Download", [](const char* url, const char* savePath, sol::this_state s,
-                                     sol::optional<std::string> proxy) -> sol::object {
-        bool result = eurl::Download(url, savePath, proxy.value_or("").c_str());
-        if (result) {
-            return sol::make_object(s, true);
-        }
-        else {
-            return sol::nil;
-        }
-    });
+    Eurl.set_function("Get", &Profiler::Timed<&luaGet>);
+    Eurl.set_function("Post", &Profiler::Timed<&luaPost>);
+    Eurl.set_function("Download", &Profiler::Timed<&luaDownload>);
+    Eurl.set_function("GetAsync", &Profiler::Timed<&luaGetAsync>);
+    Eurl.set_function("PostAsync", &Profiler::Timed<&luaPostAsync>);
+    Eurl.set_function("Pending", [] { return HttpPool::Instance().Pending(); });
+    lua.new_usertype<HttpPool::Call>("HttpCall",
+                                     sol::no_constructor,
+                                     "Ready", &HttpPool::Call::Ready,
+                                     "Await", &Profiler::Timed<&luaCallAwait>
+    );
     Eurl.set_function("MultiThreadedDownload", [](const std::string&url, const std::string&savePath,
                                                   sol::optional<size_t> numThreads) {
         eurl::MultiThreadedDownload(url, savePath, numThreads.value_or(16));
@@ -203,8 +593,64 @@ void Script::binding() {
                               "display", [](const cv::Mat&mat) {
                                   cv::imshow("Display", mat);
                                   cv::waitKey(0);
-                              }
+                              },
+                              "roi", &ImageUtils::Region,
+                              "resize", [](const cv::Mat&mat, int width, int height, sol::optional<int> interpolation) {
+                                  return ImageUtils::Resize(mat, width, height,
+                                                            interpolation.value_or(cv::INTER_LINEAR));
+                              },
+                              "cvtColor", &ImageUtils::CvtColor,
+                              "threshold", [](const cv::Mat&mat, double thresh, sol::optional<double> maxValue,
+                                              sol::optional<int> type) {
+                                  return ImageUtils::Threshold(mat, thresh, maxValue.value_or(255),
+                                                               type.value_or(cv::THRESH_BINARY));
+                              },
+                              "inRange", [](const cv::Mat&mat, const sol::table&lower, const sol::table&upper) {
+                                  return ImageUtils::InRange(mat, toScalar(lower), toScalar(upper));
+                              },
+                              "absdiff", &ImageUtils::AbsDiff,
+                              "countNonZero", &ImageUtils::CountNonZero,
+                              "countNonZeroChannels", [](const cv::Mat&mat) {
+                                  cv::Scalar counts = ImageUtils::CountNonZeroChannels(mat);
+                                  return std::make_tuple(counts[0], counts[1], counts[2], counts[3]);
+                              },
+                              "mean", [](const cv::Mat&mat, sol::optional<cv::Mat> mask) {
+                                  cv::Scalar m = ImageUtils::Mean(mat, mask.value_or(cv::Mat()));
+                                  return std::make_tuple(m[0], m[1], m[2], m[3]);
+                              },
+                              "hash", sol::overload(
+                                  [](const cv::Mat&mat) {
+                                      return hashString(ImageUtils::Hash(mat));
+                                  },
+                                  [](const cv::Mat&mat, int x, int y, int width, int height) {
+                                      return hashString(ImageUtils::Hash(ImageUtils::Region(mat, x, y, width, height)));
+                                  }
+                              ),
+                              "isSubmatrix", &cv::Mat::isSubmatrix,
+                              "type", &cv::Mat::type,
+                              "elemSize", &cv::Mat::elemSize,
+                              "step", [](const cv::Mat&mat) { return mat.step[0]; },
+                              //Raw pixel buffer for FFI, valid while the Mat is alive
+                              "data", [](cv::Mat&mat) { return static_cast<void *>(mat.data); }
     );
+    auto Color = lua.create_table("Color");
+    Color["BGR2GRAY"] = static_cast<int>(cv::COLOR_BGR2GRAY);
+    Color["BGRA2GRAY"] = static_cast<int>(cv::COLOR_BGRA2GRAY);
+    Color["BGR2RGB"] = static_cast<int>(cv::COLOR_BGR2RGB);
+    Color["BGR2HSV"] = static_cast<int>(cv::COLOR_BGR2HSV);
+    Color["HSV2BGR"] = static_cast<int>(cv::COLOR_HSV2BGR);
+    Color["GRAY2BGR"] = static_cast<int>(cv::COLOR_GRAY2BGR);
+    lua.set("Color", Color);
+    auto Interp = lua.create_table("Interp");
+    Interp["NEAREST"] = static_cast<int>(cv::INTER_NEAREST);
+    Interp["LINEAR"] = static_cast<int>(cv::INTER_LINEAR);
+    Interp["AREA"] = static_cast<int>(cv::INTER_AREA);
+    lua.set("Interp", Interp);
+    auto Thresh = lua.create_table("Thresh");
+    Thresh["BINARY"] = static_cast<int>(cv::THRESH_BINARY);
+    Thresh["BINARY_INV"] = static_cast<int>(cv::THRESH_BINARY_INV);
+    Thresh["OTSU"] = static_cast<int>(cv::THRESH_OTSU);
+    lua.set("Thresh", Thresh);
     auto IU = lua.create_table("ImageUtils");
     IU.set_function("Binary", [](const cv::Mat&src) {
         return ImageUtils::Binary(src);
@@ -217,10 +663,6 @@ void Script::binding() {
                                       sol::optional<float> thresh) {
         return ImageUtils::Find(src, templateImage, thresh.value_or(0.5f));
     });
-    IU.set_function("PrintScreen", [](std::shared_ptr<ADBC::ADBClient> adbc) {
-        return ImageUtils::PrintScreen(adbc);
-    });
-
     IU.set_function("MatchFromStr", [](const std::string&srcPath, const std::string&templatePath,
                                        sol::optional<std::string> outputPath) {
         return ImageUtils::Match(srcPath, templatePath, outputPath.value_or("assets/tmp.png"));
@@ -232,6 +674,15 @@ void Script::binding() {
     IU.set_function("Image", [](std::string path) {
         return ImageUtils::Image(path);
     });
+    IU.set_function("Template", [](const std::string&path) {
+        return ImageUtils::Template(path);
+    });
+    IU.set_function("HashDistance", [](const std::string&hash1, const std::string&hash2) {
+        return ImageUtils::HashDistance(std::stoull(hash1, nullptr, 16), std::stoull(hash2, nullptr, 16));
+    });
+    //Before PrintScreen, which yields and is timed on its own
+    Profiler::Wrap(IU);
+    IU.set_function("PrintScreen", &Profiler::Timed<&luaImagePrintScreen>);
     lua.set("ImageUtils", IU);
     lua.new_usertype<ADBC::Point>("Point",
                                   sol::constructors<ADBC::Point(float, float)>(),
@@ -241,7 +692,15 @@ void Script::binding() {
     lua.new_usertype<ADBC::AndroidEvent>("AndroidEvent",
                                          "type", &ADBC::AndroidEvent::type,
                                          "start", &ADBC::AndroidEvent::start,
-                                         "end", &ADBC::AndroidEvent::end
+                                         "end", &ADBC::AndroidEvent::end,
+                                         "tracks", &ADBC::AndroidEvent::tracks,
+                                         "pointCount", [](const ADBC::AndroidEvent&event) {
+                                             return event.points.size();
+                                         },
+                                         //Contiguous {time, x, y} floats for FFI, valid while the event is alive
+                                         "pointsData", [](ADBC::AndroidEvent&event) {
+                                             return static_cast<void *>(event.points.data());
+                                         }
     );
 
     lua.new_usertype<ADBC::ADBClient>("ADBClient",
@@ -251,20 +710,23 @@ void Script::binding() {
                                       "devices", &ADBC::ADBClient::devices,
                                       "install", &ADBC::ADBClient::install,
                                       "openActivity", &ADBC::ADBClient::openActivity,
-                                      "printScreen", &ADBC::ADBClient::printScreen,
+                                      "printScreen", &Profiler::Timed<&luaPrintScreen>,
                                       "pull", &ADBC::ADBClient::pull,
                                       "push", &ADBC::ADBClient::push,
                                       "setID", &ADBC::ADBClient::setID,
-                                      "shell", &ADBC::ADBClient::shell,
-                                      "swipe", &ADBC::ADBClient::swipe,
-                                      "tap", [](ADBC::ADBClient&client, ADBC::Point p, sol::optional<float> duration) {
-                                          return client.tap(p, duration.value_or(0));
-                                      },
-                                      "text", &ADBC::ADBClient::text,
+                                      "shell", &Profiler::Timed<&luaShell>,
+                                      "swipe", &Profiler::Timed<&luaSwipe>,
+                                      "tap", &Profiler::Timed<&luaTap>,
+                                      "text", &Profiler::Timed<&luaText>,
                                       "textUTF_8", &ADBC::ADBClient::textUTF_8,
-                                      "inputKey", &ADBC::ADBClient::inputKey,
-                                      "startRecordingAct", &ADBC::ADBClient::startRecordingAct,
+                                      "inputKey", &Profiler::Timed<&luaInputKey>,
+                                      "startRecordingAct", [](ADBC::ADBClient&client, sol::optional<bool> raw) {
+                                          client.startRecordingAct(nullptr, raw.value_or(true)
+                                                                                ? ADBC::RecordMode::Raw
+                                                                                : ADBC::RecordMode::Text);
+                                      },
                                       "stopRecordingAct", &ADBC::ADBClient::stopRecordingAct,
+                                      "pollRecordedEvents", &ADBC::ADBClient::pollRecordedEvents,
                                       "Create", [](std::string adbPath, std::string serial) {
                                           return ADBC::ADBClient::Create(adbPath, serial);
                                       },
@@ -275,33 +737,108 @@ void Script::binding() {
                                       "AxisXToScreen", &ADBC::ADBClient::AxisXToScreen,
                                       "AxisYToScreen", &ADBC::ADBClient::AxisYToScreen,
                                       "loadEvents", &ADBC::ADBClient::loadEvents,
-                                      "ReplayEvents", sol::overload(
-                                          [](ADBC::ADBClient&client, std::vector<ADBC::AndroidEvent> events,
-                                             sol::optional<bool> control) {
-                                              client.ReplayEvents(events, control.value_or(true));
-                                          },
-                                          [](ADBC::ADBClient&client, std::string name, sol::optional<bool> control) {
-                                              client.ReplayEvents(name, control.value_or(true));
-                                          }
-                                      )
+                                      "ReplayEvents", &Profiler::Timed<&luaReplayEvents>,
+                                      "getInputLatency", &ADBC::ADBClient::getInputLatency,
+                                      "setTrajectoryTolerance", &ADBC::ADBClient::setTrajectoryTolerance
+    );
+
+    lua.new_usertype<ADBC::ReplayTiming>("ReplayTiming",
+                                         "index", &ADBC::ReplayTiming::index,
+                                         "planned", &ADBC::ReplayTiming::planned,
+                                         "actual", &ADBC::ReplayTiming::actual,
+                                         "error", &ADBC::ReplayTiming::error
+    );
+
+    lua.new_usertype<ADBC::ReplayReport>("ReplayReport",
+                                         "events", &ADBC::ReplayReport::events,
+                                         "plannedDuration", &ADBC::ReplayReport::plannedDuration,
+                                         "actualDuration", &ADBC::ReplayReport::actualDuration,
+                                         "latency", &ADBC::ReplayReport::latency,
+                                         "MeanError", &ADBC::ReplayReport::MeanError,
+                                         "MaxError", &ADBC::ReplayReport::MaxError
     );
 
     lua.set_function("Save", &LoadManager::Save<std::vector<ADBC::AndroidEvent>>);
     lua.set_function("Load", &LoadManager::Load<std::vector<ADBC::AndroidEvent>>);
-    lua.set_function("Sleep", &RC::Utils::sleep);
+    lua.set_function("Sleep", &Profiler::Timed<&luaSleep>);
+    lua.set_function("Memory", [this] {
+        SampleMemory();
+        auto stats = GetMemoryStats();
+        return std::make_tuple(stats.live, stats.peak, stats.limit);
+    });
+#ifdef MIO_USE_LUAJIT
+    lua.set_function("SetMemoryLimit", [](size_t) {
+        throw sol::error("SetMemoryLimit needs the script allocator, which LuaJIT does not use");
+    });
+#else
+    lua.set_function("SetMemoryLimit", [this](size_t bytes) {
+        allocator.SetLimit(bytes);
+    });
+#endif
+    auto Prof = lua.create_table("Profiler");
+    Prof.set_function("Start", [this](sol::optional<int> instructions) {
+        if (!profiler) {
+            profiler = std::make_unique<Profiler>(lua.lua_state());
+        }
+        profiler->Start(instructions.value_or(1000));
+        profiling = true;
+    });
+    Prof.set_function("Stop", [this] {
+        if (profiler) {
+            profiler->Stop();
+        }
+        profiling = false;
+    });
+    Prof.set_function("Reset", [this] {
+        if (profiler) {
+            profiler->Reset();
+        }
+    });
+    Prof.set_function("Save", [this](const std::string&path) {
+        return profiler && profiler->ExportCollapsed(path + ".folded") && profiler->ExportChromeTrace(path + ".json");
+    });
+    lua.set("Profiler", Prof);
+}
+
+#ifdef MIO_USE_LUAJIT
+void Script::registerFFI() {
+    static_assert(sizeof(std::pair<float, ADBC::Point>) == 3 * sizeof(float),
+                  "AndroidEvent points must stay a packed {time, x, y} layout for FFI access");
+    //require("mio.ffi") gives typed views over Mat pixels and AndroidEvent points without copying them into tables
+    static const char* source = R"(
+local ffi = require("ffi")
+ffi.cdef[[typedef struct { float time; float x; float y; } MioTimedPoint;]]
+local M = {}
+function M.pixels(mat)
+    return ffi.cast("uint8_t*", mat:data()), mat:step(), mat.rows, mat.cols, mat:channels()
+end
+function M.points(event)
+    return ffi.cast("const MioTimedPoint*", event:pointsData()), event:pointCount()
+end
+return M
+)";
+    sol::load_result chunk = lua.load(source, "=mio.ffi");
+    if (chunk.valid()) {
+        lua["package"]["preload"]["mio.ffi"] = chunk.get<sol::protected_function>();
+    }
 }
+#endif
 
 bool Script::loadScript() {
+    InvalidateFunctions();
     auto script = scriptPath + "/main.lua";
-    std::ifstream scriptFile(script);
-    if (!scriptFile.is_open()) {
+    if (!RC::Utils::File::Exists(script)) {
         std::cerr << "Unable to open the script file: " << script << std::endl;
         return false;
     }
-    std::stringstream buffer;
-    buffer << scriptFile.rdbuf();
-    scriptFile.close();
-    result = lua.script(buffer.str(), sol::script_default_on_error);
+    sol::load_result chunk = BytecodeCache::Instance().Load(lua.lua_state(), script);
+    if (!chunk.valid()) {
+        sol::error err = chunk;
+        std::cerr << "Error loading script: " << err.what() << std::endl;
+        return false;
+    }
+    sol::protected_function main = chunk;
+    result = main();
     if (!result.valid()) {
         sol::error err = result;
         std::cerr << "Error loading script: " << err.what() << std::endl;
@@ -311,22 +848,147 @@ bool Script::loadScript() {
     return true;
 }
 
+void Script::installSearcher() {
+#if LUA_VERSION_NUM >= 502
+    sol::table searchers = lua["package"]["searchers"];
+#else
+    sol::table searchers = lua["package"]["loaders"];
+#endif
+    auto searcher = [this](const std::string&name, sol::this_state s) {
+        sol::state_view view(s);
+        std::string path = modules->Find(name);
+        if (path.empty()) {
+            return std::make_tuple(sol::make_object(view, "\n\tno module '" + name + "' in script index"), std::string());
+        }
+        sol::load_result chunk = BytecodeCache::Instance().Load(s, path);
+        if (!chunk.valid()) {
+            sol::error err = chunk;
+            return std::make_tuple(sol::make_object(view, "\n\t" + std::string(err.what())), std::string());
+        }
+        return std::make_tuple(sol::make_object(view, chunk.get<sol::protected_function>()), path);
+    };
+    //Right after package.preload so cached chunks win over the source searcher
+    lua["table"]["insert"](searchers, 2, sol::make_object(lua, searcher));
+}
+
 void Script::buildPackagePath(const std::string&rootPath) {
+    //Modules below the root are resolved through the shared ModuleIndex searcher, package.path only keeps the root
+    //so that the stock source searcher still works as a fallback
     std::string package_path = lua["package"]["path"].get<std::string>();
 
     std::string rootLuaPath = RC::Utils::File::AbsolutePath(RC::Utils::File::PlatformPath(rootPath + "/?.lua"));
     package_path += ";" + rootLuaPath;
-
-    for (const auto&entry: std::filesystem::recursive_directory_iterator(rootPath)) {
-        if (entry.is_directory()) {
-            std::string dirPath = entry.path().string();
-            std::string luaPath = dirPath + "/?.lua";
-            package_path += ";" + RC::Utils::File::AbsolutePath(RC::Utils::File::PlatformPath(luaPath));
-        }
-    }
 #ifndef NDEBUG
     std::cout << "package.path: " << package_path << std::endl;
 #endif
 
     lua["package"]["path"] = package_path;
+    modules = ModuleIndex::For(rootPath);
+}
+
+void Script::RequestReload(const std::vector<std::string>&changedFiles) {
+    std::lock_guard<std::mutex> lock(reloadMutex);
+    pendingReloads.insert(changedFiles.begin(), changedFiles.end());
+    reloadPending = true;
+}
+
+bool Script::ApplyPendingReload() {
+    if (!reloadPending) {
+        return false;
+    }
+    std::set<std::string> files; {
+        std::lock_guard<std::mutex> lock(reloadMutex);
+        files.swap(pendingReloads);
+        reloadPending = false;
+    }
+    const auto mainScript = std::filesystem::path(scriptPath) / "main.lua";
+    bool reloadMain = false;
+    bool reloaded = false;
+    for (const auto&file: files) {
+        //A deleted module only had to leave the module index, which dispatchReload already updated. Whatever it
+        //loaded stays in package.loaded until a module requiring it is reloaded
+        if (!std::filesystem::exists(file)) {
+            continue;
+        }
+        std::error_code ec;
+        if (std::filesystem::equivalent(file, mainScript, ec)) {
+            reloadMain = true;
+            continue;
+        }
+        reloaded |= reloadModule(file);
+    }
+    if (reloadMain) {
+        //The main chunk re-creates its globals, only the Persistent table survives
+        sol::table persistent = lua["Persistent"];
+        reloaded |= loadScript();
+        lua["Persistent"] = persistent;
+    }
+    InvalidateFunctions();
+    return reloaded;
+}
+
+std::vector<std::string> Script::moduleNames(const std::string&file) const {
+    std::vector<std::string> names;
+    auto root = std::filesystem::absolute(scriptPath).lexically_normal();
+    auto relative = std::filesystem::absolute(file).lexically_normal().lexically_relative(root);
+    if (relative.empty() || *relative.begin() == "..") {
+        return names;
+    }
+    relative.replace_extension();
+    std::vector<std::string> parts;
+    for (const auto&part: relative) {
+        parts.push_back(part.string());
+    }
+    //The ModuleIndex searcher registers every suffix of the path, but a shallower file may have claimed a suffix
+    const auto path = std::filesystem::absolute(file).lexically_normal();
+    for (size_t i = 0; i < parts.size(); i++) {
+        std::string name;
+        for (size_t j = i; j < parts.size(); j++) {
+            name += (j == i ? "" : ".") + parts[j];
+        }
+        if (const std::string found = modules ? modules->Find(name) : "";
+            !found.empty() && std::filesystem::path(found).lexically_normal() == path) {
+            names.push_back(name);
+        }
+    }
+    return names;
+}
+
+bool Script::reloadModule(const std::string&file) {
+    sol::table loaded = lua["package"]["loaded"];
+    bool reloaded = false;
+    for (const auto&name: moduleNames(file)) {
+        sol::object old = loaded[name];
+        if (!old.valid() || old.get_type() == sol::type::lua_nil) {
+            continue;
+        }
+        sol::load_result chunk = BytecodeCache::Instance().Load(lua.lua_state(), file);
+        if (!chunk.valid()) {
+            sol::error err = chunk;
+            std::cerr << "Error reloading module " << name << ": " << err.what() << std::endl;
+            return reloaded;
+        }
+        sol::protected_function func = chunk;
+        sol::protected_function_result ret = func(name, file);
+        if (!ret.valid()) {
+            sol::error err = ret;
+            std::cerr << "Error reloading module " << name << ": " << err.what() << std::endl;
+            return reloaded;
+        }
+        sol::object fresh = ret.get<sol::object>();
+        if (old.is<sol::table>() && fresh.is<sol::table>()) {
+            //Patch in place so existing references keep working, data fields already present are kept
+            sol::table target = old.as<sol::table>();
+            for (const auto&[key, value]: fresh.as<sol::table>()) {
+                if (value.is<sol::function>() || target[key].get_type() == sol::type::lua_nil) {
+                    target[key] = value;
+                }
+            }
+        }
+        else if (fresh.valid() && fresh.get_type() != sol::type::lua_nil) {
+            loaded[name] = fresh;
+        }
+        reloaded = true;
+    }
+    return reloaded;
 }
@@ -1,6 +1,11 @@
 #ifndef SCRIPTINTERPRETER_H
 #define SCRIPTINTERPRETER_H
 
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <unordered_map>
 #include <sol/sol.hpp>
 #include <opencv2/opencv.hpp>
 
@@ -9,16 +14,26 @@
 #include "Utils.h"
 #include "ImageUtils.h"
 #include "ADBClient.h"
+#include "Profiler.h"
+#include "ScriptAllocator.h"
 using namespace EURL;
 
+class ModuleIndex;
+
 class Script {
 public:
     friend class ScriptManager;
+    friend class Scheduler;
+    friend struct ScriptFunctions;
 
     Script();
 
     bool Initialize(std::string scriptsPath);
 
+    //Another instance of an initialized script. main.lua and the modules come from the bytecode cache entries the
+    //prototype verified, so neither the directory nor unchanged sources are read again
+    bool Initialize(const Script&prototype);
+
     sol::protected_function getFunction(const std::string&funcName);
 
     template<typename... Args>
@@ -28,23 +43,92 @@ public:
 
     void PrintAllFunctions();
 
+    void InvalidateFunctions();
+
+    //Thread-safe. Under LuaJIT this is the collector's count as of the last SampleMemory
+    ScriptAllocator::Stats GetMemoryStats() const;
+
+    //Call from the thread running the state, the scheduler does at every tick. Reads the LuaJIT collector's count,
+    //the script allocator keeps its own statistics
+    void SampleMemory();
+
+    //Thread-safe, applied by ApplyPendingProfiler at the next tick. When stopping with a non-empty exportPath the
+    //collected profile is written to exportPath.folded and exportPath.json
+    void RequestProfiling(bool enable, const std::string&exportPath = "");
+
+    void ApplyPendingProfiler();
+
+    bool IsProfiling() const {
+        return profiling;
+    }
+
+    //Has no effect under LuaJIT, which does not use the script allocator
+    void SetMemoryLimit(size_t bytes);
+
+    //Thread-safe, the reload itself happens on the script's own thread in ApplyPendingReload
+    void RequestReload(const std::vector<std::string>&changedFiles);
+
+    //Call at a tick boundary or under the invoke lock, returns true when something was reloaded
+    bool ApplyPendingReload();
+
 private:
+    struct CachedFunction {
+        sol::protected_function func;
+        const void* identity = nullptr;
+    };
+
+    //Resolves a global function through the cache, the handle is rebuilt when the global has been reassigned
+    sol::protected_function* resolve(const std::string&funcName);
+
     void binding();
 
+    //Everything Initialize does before running main.lua
+    void setup(const std::string&scriptsPath);
+
     bool loadScript();
 
+    bool reloadModule(const std::string&file);
+
+    std::vector<std::string> moduleNames(const std::string&file) const;
+
     void buildPackagePath(const std::string&rootPath);
 
+    void installSearcher();
+
+#ifdef MIO_USE_LUAJIT
+    void registerFFI();
+#endif
+
+    //Declared before lua so that it outlives the state it backs
+    ScriptAllocator allocator;
     sol::state lua;
     sol::protected_function_result result;
     std::string scriptPath;
+    std::unordered_map<std::string, CachedFunction> functions;
+    std::shared_ptr<ModuleIndex> modules;
+    std::mutex reloadMutex;
+    std::set<std::string> pendingReloads;
+    std::atomic<bool> reloadPending = false;
+    std::mutex invokeMutex;
+    //Declared after lua so that its hook is removed before the state goes away
+    std::unique_ptr<Profiler> profiler;
+    std::mutex profilerMutex;
+    std::optional<std::pair<bool, std::string>> profilerRequest;
+    std::atomic<bool> profilerPending = false;
+    std::atomic<bool> profiling = false;
+#ifdef MIO_USE_LUAJIT
+    std::atomic<size_t> collectorLive = 0;
+    std::atomic<size_t> collectorPeak = 0;
+#endif
 };
 
 template<typename... Args>
 sol::object Script::Invoke(const std::string&funcName, Args&&... args) {
-    if (checkFunc(funcName)) {
-        sol::protected_function func = lua[funcName];
-        auto ret = func(std::forward<Args>(args)...);
+    //Waits for a call that is still running, e.g. one ParallelInvokes gave up on
+    std::lock_guard<std::mutex> lock(invokeMutex);
+    ApplyPendingReload();
+    if (sol::protected_function* func = resolve(funcName)) {
+        auto ret = (*func)(std::forward<Args>(args)...);
         if (ret.valid()) {
             return ret;
         }
@@ -0,0 +1,110 @@
+#include "ScriptAllocator.h"
+
+#include <cstdlib>
+#include <cstring>
+
+ScriptAllocator::~ScriptAllocator() {
+    for (void* chunk: chunks) {
+        std::free(chunk);
+    }
+}
+
+void* ScriptAllocator::Alloc(void* ud, void* ptr, size_t osize, size_t nsize) {
+    auto* self = static_cast<ScriptAllocator *>(ud);
+    if (nsize == 0) {
+        if (ptr != nullptr) {
+            self->deallocate(ptr, osize);
+            self->account(osize, 0);
+        }
+        return nullptr;
+    }
+    //For a new block Lua passes the object type in osize, not a size
+    const size_t oldSize = ptr == nullptr ? 0 : osize;
+    const size_t limit = self->limit.load(std::memory_order_relaxed);
+    if (limit != 0 && nsize > oldSize && self->live.load(std::memory_order_relaxed) + nsize - oldSize > limit) {
+        return nullptr;
+    }
+    void* block = ptr == nullptr ? self->allocate(nsize) : self->reallocate(ptr, osize, nsize);
+    if (block != nullptr) {
+        self->account(oldSize, nsize);
+    }
+    return block;
+}
+
+ScriptAllocator::Stats ScriptAllocator::GetStats() const {
+    return {live.load(), peak.load(), limit.load()};
+}
+
+void ScriptAllocator::SetLimit(size_t bytes) {
+    limit = bytes;
+}
+
+void* ScriptAllocator::allocate(size_t size) {
+    if (size > MaxSmall) {
+        return std::malloc(size);
+    }
+    const size_t sizeClass = classOf(size);
+    if (freeLists[sizeClass] == nullptr) {
+        refill(sizeClass);
+        if (freeLists[sizeClass] == nullptr) {
+            return nullptr;
+        }
+    }
+    FreeBlock* block = freeLists[sizeClass];
+    freeLists[sizeClass] = block->next;
+    return block;
+}
+
+void ScriptAllocator::deallocate(void* ptr, size_t size) {
+    if (size > MaxSmall) {
+        std::free(ptr);
+        return;
+    }
+    const size_t sizeClass = classOf(size);
+    auto* block = static_cast<FreeBlock *>(ptr);
+    block->next = freeLists[sizeClass];
+    freeLists[sizeClass] = block;
+}
+
+void* ScriptAllocator::reallocate(void* ptr, size_t osize, size_t nsize) {
+    if (osize > MaxSmall && nsize > MaxSmall) {
+        return std::realloc(ptr, nsize);
+    }
+    if (osize <= MaxSmall && nsize <= MaxSmall && classOf(osize) == classOf(nsize)) {
+        return ptr;
+    }
+    void* block = allocate(nsize);
+    if (block == nullptr) {
+        return nullptr;
+    }
+    std::memcpy(block, ptr, osize < nsize ? osize : nsize);
+    deallocate(ptr, osize);
+    return block;
+}
+
+void ScriptAllocator::refill(size_t sizeClass) {
+    const size_t blockSize = (sizeClass + 1) * Granularity;
+    void* chunk = std::malloc(ChunkSize);
+    if (chunk == nullptr) {
+        return;
+    }
+    chunks.push_back(chunk);
+    auto* base = static_cast<char *>(chunk);
+    for (size_t offset = 0; offset + blockSize <= ChunkSize; offset += blockSize) {
+        auto* block = reinterpret_cast<FreeBlock *>(base + offset);
+        block->next = freeLists[sizeClass];
+        freeLists[sizeClass] = block;
+    }
+}
+
+void ScriptAllocator::account(size_t osize, size_t nsize) {
+    if (nsize >= osize) {
+        size_t current = live.fetch_add(nsize - osize, std::memory_order_relaxed) + nsize - osize;
+        size_t previous = peak.load(std::memory_order_relaxed);
+        while (current > previous && !peak.compare_exchange_weak(previous, current, std::memory_order_relaxed)) {
+        }
+    }
+    else {
+        live.fetch_sub(osize - nsize, std::memory_order_relaxed);
+    }
+}
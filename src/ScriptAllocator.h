@@ -0,0 +1,66 @@
+#ifndef SCRIPTALLOCATOR_H
+#define SCRIPTALLOCATOR_H
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+//lua_Alloc backend for one sol::state. Blocks up to MaxSmall bytes come from per-size-class free lists carved out
+//of 64 KiB chunks, larger ones go to malloc. A lua_State is only ever used from one thread at a time so the pools
+//are unsynchronized, the statistics are atomics so that the GUI can read them from its own thread.
+class ScriptAllocator {
+public:
+    struct Stats {
+        size_t live;
+        size_t peak;
+        size_t limit;
+    };
+
+    ScriptAllocator() = default;
+
+    ~ScriptAllocator();
+
+    ScriptAllocator(const ScriptAllocator&) = delete;
+
+    ScriptAllocator& operator=(const ScriptAllocator&) = delete;
+
+    static void* Alloc(void* ud, void* ptr, size_t osize, size_t nsize);
+
+    Stats GetStats() const;
+
+    //0 disables the limit, allocations that would exceed it fail and surface as Lua memory errors
+    void SetLimit(size_t bytes);
+
+private:
+    static constexpr size_t Granularity = 16;
+    static constexpr size_t MaxSmall = 256;
+    static constexpr size_t ClassCount = MaxSmall / Granularity;
+    static constexpr size_t ChunkSize = 64 * 1024;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    static size_t classOf(size_t size) {
+        return (size + Granularity - 1) / Granularity - 1;
+    }
+
+    void* allocate(size_t size);
+
+    void deallocate(void* ptr, size_t size);
+
+    void* reallocate(void* ptr, size_t osize, size_t nsize);
+
+    void refill(size_t sizeClass);
+
+    void account(size_t osize, size_t nsize);
+
+    std::array<FreeBlock *, ClassCount> freeLists{};
+    std::vector<void *> chunks;
+    std::atomic<size_t> live = 0;
+    std::atomic<size_t> peak = 0;
+    std::atomic<size_t> limit = 0;
+};
+
+
+#endif //SCRIPTALLOCATOR_H
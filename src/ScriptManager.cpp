@@ -1,11 +1,16 @@
 #include "ScriptManager.h"
 
+#include <ranges>
+
+#include "ModuleIndex.h"
+
 sol::protected_function ScriptFunctions::operator[](int index) {
     return funcs[index];
 }
 
-void ScriptFunctions::Add(sol::protected_function func) {
+void ScriptFunctions::Add(sol::protected_function func, std::shared_ptr<Script> owner) {
     funcs.push_back(func);
+    owners.push_back(std::move(owner));
 }
 
 void ScriptManager::Add(std::string scriptPath) {
@@ -19,17 +24,52 @@ void ScriptManager::Adds(std::vector<std::string> scriptPaths) {
 }
 
 void ScriptManager::Initialize() {
+    std::vector<std::string> paths;
     while (!scriptsQueue.empty()) {
-        std::string scriptPath = scriptsQueue.front();
+        paths.push_back(scriptsQueue.front());
         scriptsQueue.pop();
-        std::shared_ptr<Script> script = std::make_shared<Script>();
-        if (script->Initialize(scriptPath)) {
+    }
+    if (paths.empty()) {
+        return;
+    }
+    //Every Script owns an independent sol::state, the shared bytecode cache and module index are thread-safe
+    ThreadPool pool(std::min<size_t>(paths.size(), std::max(1u, std::thread::hardware_concurrency())));
+    std::vector<std::future<std::shared_ptr<Script>>> futures;
+    futures.reserve(paths.size());
+    for (auto&scriptPath: paths) {
+        futures.push_back(pool.enqueue([scriptPath]() -> std::shared_ptr<Script> {
+            std::shared_ptr<Script> script = std::make_shared<Script>();
+            if (script->Initialize(scriptPath)) {
+                return script;
+            }
+            return nullptr;
+        }));
+    }
+    for (auto&future: futures) {
+        if (auto script = future.get()) {
+            std::lock_guard<std::mutex> lock(scriptsMutex);
             scripts.push_back(script);
         }
     }
 }
 
+std::shared_ptr<Script> ScriptManager::Spawn(std::string scriptPath) {
+    auto prototype = GetScript(scriptPath);
+    if (prototype == nullptr) {
+        std::cerr << "Script not loaded: " << scriptPath << std::endl;
+        return nullptr;
+    }
+    //The prototype already verified the bytecode cache entries and filled the module index, so this skips reading
+    //and compiling the sources as well as the walk
+    std::shared_ptr<Script> script = std::make_shared<Script>();
+    if (!script->Initialize(*prototype)) {
+        return nullptr;
+    }
+    return script;
+}
+
 void ScriptManager::Delete(std::string scriptPath) {
+    std::lock_guard<std::mutex> lock(scriptsMutex);
     for (auto it = scripts.begin(); it != scripts.end(); ++it) {
         if ((*it)->scriptPath == scriptPath) {
             scripts.erase(it);
@@ -40,6 +80,7 @@ void ScriptManager::Delete(std::string scriptPath) {
 
 std::shared_ptr<Script> ScriptManager::GetScript(std::string scriptPath) {
     scriptPath = RC::Utils::File::PlatformPath(scriptsRoot + "/" + scriptPath);
+    std::lock_guard<std::mutex> lock(scriptsMutex);
     for (auto&script: scripts) {
         if (script->scriptPath == scriptPath) {
             return script;
@@ -48,6 +89,31 @@ std::shared_ptr<Script> ScriptManager::GetScript(std::string scriptPath) {
     return nullptr;
 }
 
+std::shared_ptr<Script> ScriptManager::Acquire(std::string scriptPath, const std::string&device) {
+    std::pair<std::string, std::string> key = {scriptPath, device}; {
+        std::lock_guard<std::mutex> lock(scriptsMutex);
+        auto it = instances.find(key);
+        if (it != instances.end()) {
+            return it->second;
+        }
+    }
+    auto script = Spawn(scriptPath);
+    if (script == nullptr) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(scriptsMutex);
+    return instances.emplace(key, script).first->second;
+}
+
+void ScriptManager::Release(std::string scriptPath, const std::string&device,
+                            const std::shared_ptr<Script>&instance) {
+    std::lock_guard<std::mutex> lock(scriptsMutex);
+    auto it = instances.find({scriptPath, device});
+    if (it != instances.end() && (instance == nullptr || it->second == instance)) {
+        instances.erase(it);
+    }
+}
+
 std::vector<std::string> ScriptManager::Scan(std::string scriptsRoot) {
     scriptsRoot = RC::Utils::File::PlatformPath(scriptsRoot);
     return RC::Utils::Directory::List(scriptsRoot);
@@ -55,8 +121,46 @@ std::vector<std::string> ScriptManager::Scan(std::string scriptsRoot) {
 
 ScriptFunctions ScriptManager::GetFuncs(std::string funcName) const {
     ScriptFunctions funcs;
+    std::lock_guard<std::mutex> lock(scriptsMutex);
     for (auto&script: scripts) {
-        funcs.Add(script->getFunction(funcName));
+        funcs.Add(script->getFunction(funcName), script);
     }
     return funcs;
 }
+
+void ScriptManager::EnableHotReload() {
+    if (watcher) {
+        return;
+    }
+    watcher = std::make_unique<ScriptWatcher>(scriptsRoot, [this](const std::vector<std::string>&changedFiles) {
+        dispatchReload(changedFiles);
+    });
+    watcher->Start();
+}
+
+void ScriptManager::DisableHotReload() {
+    watcher.reset();
+}
+
+void ScriptManager::dispatchReload(const std::vector<std::string>&changedFiles) {
+    std::lock_guard<std::mutex> lock(scriptsMutex);
+    std::vector<std::shared_ptr<Script>> targets = scripts;
+    for (auto&instance: instances | std::views::values) {
+        targets.push_back(instance);
+    }
+    for (auto&script: targets) {
+        auto root = std::filesystem::absolute(script->scriptPath).lexically_normal();
+        std::vector<std::string> owned;
+        for (const auto&file: changedFiles) {
+            auto path = std::filesystem::absolute(file).lexically_normal();
+            auto relative = path.lexically_relative(root);
+            if (!relative.empty() && *relative.begin() != "..") {
+                owned.push_back(path.string());
+            }
+        }
+        if (!owned.empty()) {
+            ModuleIndex::For(script->scriptPath)->Update(owned);
+            script->RequestReload(owned);
+        }
+    }
+}
@@ -1,10 +1,17 @@
 #ifndef SCRIPTMANAGER_H
 #define SCRIPTMANAGER_H
+#include <chrono>
+#include <map>
+#include <optional>
 #include <string>
 #include <vector>
 #include "Script.h"
+#include "ScriptWatcher.h"
+#include "ThreadPool.h"
 #include "../MUI/ResourceManager.h"
 
+//Functions of several scripts. Invokes enters each owning script under its invoke lock, calling the functions
+//directly through the iterators bypasses it.
 struct ScriptFunctions {
     using iterator = std::vector<sol::protected_function>::iterator;
 
@@ -24,10 +31,23 @@ struct ScriptFunctions {
 
     sol::protected_function operator[](int index);
 
-    void Add(sol::protected_function func);
+    void Add(sol::protected_function func, std::shared_ptr<Script> owner);
 
 private:
     std::vector<sol::protected_function> funcs;
+    std::vector<std::shared_ptr<Script>> owners;
+};
+
+template<typename T>
+struct InvokeResult {
+    std::string script;
+    std::optional<T> value;
+    std::string error;
+    bool timedOut = false;
+
+    bool ok() const {
+        return error.empty() && !timedOut;
+    }
 };
 
 class ScriptManager {
@@ -48,6 +68,16 @@ public:
 
     std::shared_ptr<Script> GetScript(std::string scriptPath);
 
+    //Fresh, independent instance of an already loaded script, e.g. for another device
+    std::shared_ptr<Script> Spawn(std::string scriptPath);
+
+    //Per-(script, device) instance with its own globals, created on first use. Instances share the compiled chunks,
+    //the module index and the template image cache with the loaded script but never its sol::state.
+    std::shared_ptr<Script> Acquire(std::string scriptPath, const std::string&device);
+
+    //Drops the instance unless it has already been replaced by a newer one
+    void Release(std::string scriptPath, const std::string&device, const std::shared_ptr<Script>&instance = nullptr);
+
 
     template<typename T, typename... Args>
     std::vector<T> Invokes(std::string funcName, Args&&... args);
@@ -61,29 +91,55 @@ public:
     template<typename... Args>
     void Invokes(ScriptFunctions funcs, Args&&... args);
 
+    //Calls funcName on every loaded script at once on the invoke pool, use sol::object as T for hooks without results:
+    //references into a script's state are released under its invoke lock and come back empty. Results keep the
+    //script order, a script that
+    //misses the timeout is reported as timed out and finishes in the background. A script still busy with an
+    //earlier call is reported instead of being entered twice.
+    template<typename T, typename... Args>
+    std::vector<InvokeResult<T>> ParallelInvokes(std::string funcName, std::chrono::milliseconds timeout,
+                                                 Args&&... args);
+
     static std::vector<std::string> Scan(std::string scriptsRoot = RESOURCING("scripts"));
 
     ScriptFunctions GetFuncs(std::string funcName) const;
 
+    //Watches the scripts root and queues changed modules on the owning scripts, applied at their next tick
+    void EnableHotReload();
+
+    void DisableHotReload();
+
 private:
+    void dispatchReload(const std::vector<std::string>&changedFiles);
+
     std::string scriptsRoot = RESOURCING("scripts");
     std::queue<std::string> scriptsQueue;
     std::vector<std::shared_ptr<Script>> scripts;
+    std::map<std::pair<std::string, std::string>, std::shared_ptr<Script>> instances;
+    mutable std::mutex scriptsMutex;
+    std::unique_ptr<ScriptWatcher> watcher;
+    std::once_flag invokePoolOnce;
+    std::unique_ptr<ThreadPool> invokePool;
 };
 
 template<typename T, typename... Args>
 std::vector<T> ScriptFunctions::Invokes(Args&&... args) {
     std::vector<T> results;
-    for (auto&func: funcs) {
-        results.push_back(func(std::forward<Args>(args)...));
+    results.reserve(funcs.size());
+    for (size_t i = 0; i < funcs.size(); i++) {
+        std::lock_guard<std::mutex> lock(owners[i]->invokeMutex);
+        owners[i]->ApplyPendingReload();
+        results.push_back(funcs[i](std::forward<Args>(args)...));
     }
     return results;
 }
 
 template<typename... Args>
 void ScriptFunctions::Invokes(Args&&... args) {
-    for (auto&func: funcs) {
-        sol::protected_function_result r = func(std::forward<Args>(args)...);
+    for (size_t i = 0; i < funcs.size(); i++) {
+        std::lock_guard<std::mutex> lock(owners[i]->invokeMutex);
+        owners[i]->ApplyPendingReload();
+        sol::protected_function_result r = funcs[i](std::forward<Args>(args)...);
         if (!r.valid()) {
             sol::error err = r;
             std::cerr << "Error call function: " << err.what() << std::endl;
@@ -93,7 +149,9 @@ void ScriptFunctions::Invokes(Args&&... args) {
 
 template<typename T, typename... Args>
 std::vector<T> ScriptManager::Invokes(std::string funcName, Args&&... args) {
+    std::lock_guard<std::mutex> lock(scriptsMutex);
     std::vector<T> results;
+    results.reserve(scripts.size());
     for (auto&script: scripts) {
         results.push_back(script->Invoke(funcName, std::forward<Args>(args)...));
     }
@@ -102,30 +160,87 @@ std::vector<T> ScriptManager::Invokes(std::string funcName, Args&&... args) {
 
 template<typename T, typename... Args>
 std::vector<T> ScriptManager::Invokes(ScriptFunctions funcs, Args&&... args) {
-    std::vector<T> results;
-    for (auto&func: funcs) {
-        results.push_back(func(std::forward<Args>(args)...));
-    }
-    return results;
+    return funcs.template Invokes<T>(std::forward<Args>(args)...);
 }
 
 template<typename... Args>
 void ScriptManager::Invokes(ScriptFunctions funcs, Args&&... args) {
-    for (auto&func: funcs) {
-        sol::protected_function_result r = func(std::forward<Args>(args)...);
-        if (!r.valid()) {
-            sol::error err = r;
-            std::cerr << "Error call function: " << err.what() << std::endl;
-        }
-    }
+    funcs.Invokes(std::forward<Args>(args)...);
 }
 
 template<typename... Args>
 void ScriptManager::Invokes(std::string funcName, Args&&... args) {
+    std::lock_guard<std::mutex> lock(scriptsMutex);
     for (auto&script: scripts) {
         script->Invoke(funcName, std::forward<Args>(args)...);
     }
 }
 
+template<typename T, typename... Args>
+std::vector<InvokeResult<T>> ScriptManager::ParallelInvokes(std::string funcName, std::chrono::milliseconds timeout,
+                                                            Args&&... args) {
+    std::call_once(invokePoolOnce, [this] {
+        invokePool = std::make_unique<ThreadPool>(std::max(2u, std::thread::hardware_concurrency()));
+    });
+    std::vector<std::shared_ptr<Script>> targets; {
+        std::lock_guard<std::mutex> lock(scriptsMutex);
+        targets = scripts;
+    }
+    auto packed = std::make_shared<std::tuple<std::decay_t<Args>...>>(std::forward<Args>(args)...);
+    std::vector<std::future<InvokeResult<T>>> futures;
+    futures.reserve(targets.size());
+    for (auto&script: targets) {
+        futures.push_back(invokePool->enqueue([script, funcName, packed] {
+            InvokeResult<T> result;
+            result.script = script->scriptPath;
+            std::unique_lock<std::mutex> lock(script->invokeMutex, std::try_to_lock);
+            if (!lock.owns_lock()) {
+                result.error = "Script is busy with an earlier call";
+                return result;
+            }
+            //Scripts that are only ever invoked have no tick to apply their reloads at
+            script->ApplyPendingReload();
+            sol::protected_function* func = script->resolve(funcName);
+            if (func == nullptr) {
+                result.error = "Function not found: " + funcName;
+                return result;
+            }
+            sol::protected_function_result ret = std::apply([func](auto&... values) {
+                return (*func)(values...);
+            }, *packed);
+            if (!ret.valid()) {
+                sol::error err = ret;
+                result.error = err.what();
+                return result;
+            }
+            auto value = ret.template get<sol::optional<T>>();
+            if (!value) {
+                result.error = "Unexpected return type from " + funcName;
+            }
+            else if constexpr (sol::is_lua_reference<T>::value) {
+                //Unreferenced with the state in use by another thread once the lock is gone, so dropped right here
+                result.value = T();
+            }
+            else {
+                result.value = std::move(*value);
+            }
+            return result;
+        }));
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::vector<InvokeResult<T>> results(targets.size());
+    for (size_t i = 0; i < futures.size(); i++) {
+        if (futures[i].wait_until(deadline) == std::future_status::ready) {
+            results[i] = futures[i].get();
+        }
+        else {
+            results[i].script = targets[i]->scriptPath;
+            results[i].timedOut = true;
+        }
+    }
+    return results;
+}
+
 
 #endif //SCRIPTMANAGER_H
@@ -0,0 +1,148 @@
+#include "ScriptWatcher.h"
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <ranges>
+#include <set>
+
+#ifdef __linux__
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+namespace fs = std::filesystem;
+
+static bool isLuaFile(const fs::path&path) {
+    return path.extension() == ".lua";
+}
+
+ScriptWatcher::ScriptWatcher(std::string root, Callback callback): root(std::move(root)),
+                                                                    callback(std::move(callback)) {
+}
+
+ScriptWatcher::~ScriptWatcher() {
+    Stop();
+}
+
+void ScriptWatcher::Start() {
+    if (running) {
+        return;
+    }
+    running = true;
+#ifdef __linux__
+    thread = std::thread(&ScriptWatcher::watch, this);
+#else
+    thread = std::thread(&ScriptWatcher::poll, this);
+#endif
+}
+
+void ScriptWatcher::Stop() {
+    running = false;
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void ScriptWatcher::addWatches(const std::string&dir) {
+#ifdef __linux__
+    constexpr uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+    int wd = inotify_add_watch(fd, dir.c_str(), mask);
+    if (wd >= 0) {
+        watches[wd] = dir;
+    }
+    std::error_code ec;
+    for (const auto&entry: fs::recursive_directory_iterator(dir, ec)) {
+        if (entry.is_directory()) {
+            wd = inotify_add_watch(fd, entry.path().string().c_str(), mask);
+            if (wd >= 0) {
+                watches[wd] = entry.path().string();
+            }
+        }
+    }
+#endif
+}
+
+void ScriptWatcher::watch() {
+#ifdef __linux__
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "inotify unavailable, falling back to polling: " << root << std::endl;
+        poll();
+        return;
+    }
+    addWatches(root);
+
+    std::set<std::string> changed;
+    auto lastEvent = std::chrono::steady_clock::now();
+    alignas(inotify_event) char buffer[4096];
+    while (running) {
+        pollfd pfd = {fd, POLLIN, 0};
+        if (::poll(&pfd, 1, 50) > 0) {
+            ssize_t length;
+            while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+                for (char* ptr = buffer; ptr < buffer + length;) {
+                    auto* event = reinterpret_cast<inotify_event *>(ptr);
+                    ptr += sizeof(inotify_event) + event->len;
+                    auto it = watches.find(event->wd);
+                    if (it == watches.end() || event->len == 0) {
+                        continue;
+                    }
+                    fs::path path = fs::path(it->second) / event->name;
+                    if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO))) {
+                        addWatches(path.string());
+                    }
+                    else if (isLuaFile(path)) {
+                        changed.insert(path.string());
+                    }
+                }
+            }
+            lastEvent = std::chrono::steady_clock::now();
+            continue;
+        }
+        //Editors write files in several steps, deliver only once the burst has settled
+        if (!changed.empty() && std::chrono::steady_clock::now() - lastEvent > std::chrono::milliseconds(50)) {
+            callback({changed.begin(), changed.end()});
+            changed.clear();
+        }
+    }
+    close(fd);
+    fd = -1;
+    watches.clear();
+#endif
+}
+
+void ScriptWatcher::poll() {
+    std::unordered_map<std::string, fs::file_time_type> times;
+    auto scan = [&](bool report) {
+        std::vector<std::string> changed;
+        std::unordered_map<std::string, fs::file_time_type> current;
+        std::error_code ec;
+        for (const auto&entry: fs::recursive_directory_iterator(root, ec)) {
+            if (!entry.is_regular_file() || !isLuaFile(entry.path())) {
+                continue;
+            }
+            std::string path = entry.path().string();
+            current[path] = entry.last_write_time(ec);
+            auto it = times.find(path);
+            if (it == times.end() || it->second != current[path]) {
+                changed.push_back(path);
+            }
+        }
+        for (const auto&path: times | std::views::keys) {
+            if (!current.contains(path)) {
+                changed.push_back(path);
+            }
+        }
+        times = std::move(current);
+        if (report && !changed.empty()) {
+            callback(changed);
+        }
+    };
+    scan(false);
+    while (running) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        scan(true);
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef SCRIPTWATCHER_H
+#define SCRIPTWATCHER_H
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//Watches a scripts root for changed .lua files. Uses inotify on Linux and falls back to polling modification times
+//elsewhere. Changes are debounced and delivered in batches from the watcher thread.
+class ScriptWatcher {
+public:
+    using Callback = std::function<void(const std::vector<std::string>&changedFiles)>;
+
+    ScriptWatcher(std::string root, Callback callback);
+
+    ~ScriptWatcher();
+
+    void Start();
+
+    void Stop();
+
+    bool IsRunning() const {
+        return running;
+    }
+
+private:
+    void watch();
+
+    void poll();
+
+    void addWatches(const std::string&dir);
+
+    std::string root;
+    Callback callback;
+    std::atomic<bool> running = false;
+    std::thread thread;
+    int fd = -1;
+    std::unordered_map<int, std::string> watches;
+};
+
+
+#endif //SCRIPTWATCHER_H
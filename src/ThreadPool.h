@@ -44,11 +44,9 @@ auto ThreadPool::enqueue(F&&f, Args&&... args) -> std::future<typename std::invo
     );
     std::future<return_type> res = task->get_future(); {
         std::unique_lock<std::mutex> lock(queue_mutex);
-        if (tasks.empty()) {
-            condition.notify_one();
-        }
         tasks.push([task]() { (*task)(); });
     }
+    condition.notify_one();
     return res;
 }
 
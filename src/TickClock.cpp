@@ -0,0 +1,120 @@
+#include "TickClock.h"
+
+#include <bit>
+
+std::string FixedRate::OverrunToString(Overrun overrun) {
+    switch (overrun) {
+        case Overrun::Skip: return "Skip";
+        case Overrun::CatchUp: return "CatchUp";
+        case Overrun::Stretch: return "Stretch";
+        default: return "Skip";
+    }
+}
+
+FixedRate::Overrun FixedRate::OverrunFromString(const std::string&overrun) {
+    if (overrun == "CatchUp") {
+        return Overrun::CatchUp;
+    }
+    if (overrun == "Stretch") {
+        return Overrun::Stretch;
+    }
+    return Overrun::Skip;
+}
+
+void TickStats::Record(std::chrono::microseconds duration, bool overrun, uint64_t skipped) {
+    const int64_t us = std::max<int64_t>(duration.count(), 0);
+    //Bucket 0 holds everything below 64us, each further bucket doubles the bound
+    size_t bucket = us < 64 ? 0 : std::min<size_t>(std::bit_width(static_cast<uint64_t>(us)) - 6, Buckets - 1);
+    histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+    ticks.fetch_add(1, std::memory_order_relaxed);
+    totalMicroseconds.fetch_add(us, std::memory_order_relaxed);
+    if (overrun) {
+        overruns.fetch_add(1, std::memory_order_relaxed);
+    }
+    this->skipped.fetch_add(skipped, std::memory_order_relaxed);
+    int64_t previous = maxMicroseconds.load(std::memory_order_relaxed);
+    while (us > previous && !maxMicroseconds.compare_exchange_weak(previous, us, std::memory_order_relaxed)) {
+    }
+}
+
+TickStats::Snapshot TickStats::GetSnapshot() const {
+    Snapshot snapshot{};
+    for (size_t i = 0; i < Buckets; i++) {
+        snapshot.histogram[i] = histogram[i].load(std::memory_order_relaxed);
+    }
+    snapshot.ticks = ticks.load(std::memory_order_relaxed);
+    snapshot.overruns = overruns.load(std::memory_order_relaxed);
+    snapshot.skipped = skipped.load(std::memory_order_relaxed);
+    snapshot.maxMicroseconds = maxMicroseconds.load(std::memory_order_relaxed);
+    snapshot.meanMicroseconds = snapshot.ticks == 0
+                                    ? 0
+                                    : static_cast<double>(totalMicroseconds.load(std::memory_order_relaxed)) /
+                                      static_cast<double>(snapshot.ticks);
+    return snapshot;
+}
+
+std::string TickStats::BucketLabel(size_t bucket) {
+    if (bucket == Buckets - 1) {
+        return ">=" + std::to_string(64ull << (bucket - 1)) + "us";
+    }
+    return "<" + std::to_string(64ull << bucket) + "us";
+}
+
+std::string TickStats::HistogramText(const Snapshot&snapshot) {
+    std::string text;
+    for (size_t i = 0; i < Buckets; i++) {
+        if (snapshot.histogram[i] != 0) {
+            text += (text.empty() ? "" : " ") + BucketLabel(i) + ":" + std::to_string(snapshot.histogram[i]);
+        }
+    }
+    return text;
+}
+
+TickClock::TickClock(const FixedRate&rate): rate(rate) {
+    Reset(Clock::now());
+}
+
+void TickClock::Reset(Clock::time_point now) {
+    next = now;
+    previousBegin = now;
+    begin = now;
+    first = true;
+}
+
+float TickClock::Begin(Clock::time_point now) {
+    begin = now;
+    float dt = first ? std::chrono::duration<float>(rate.interval).count()
+                   : std::chrono::duration<float>(now - previousBegin).count();
+    previousBegin = now;
+    first = false;
+    return dt;
+}
+
+TickClock::Clock::time_point TickClock::End(Clock::time_point now, TickStats* stats) {
+    next += rate.interval;
+    bool overrun = now > next;
+    uint64_t skipped = 0;
+    if (overrun) {
+        switch (rate.overrun) {
+            case FixedRate::Overrun::Skip: {
+                auto behind = (now - next) / rate.interval + 1;
+                skipped = static_cast<uint64_t>(behind);
+                next += rate.interval * behind;
+                break;
+            }
+            case FixedRate::Overrun::CatchUp:
+                if (now - next > rate.interval * rate.maxCatchUp) {
+                    skipped = static_cast<uint64_t>((now - next) / rate.interval);
+                    next = now;
+                }
+                break;
+            case FixedRate::Overrun::Stretch:
+                next = now + rate.interval;
+                break;
+        }
+    }
+    if (stats != nullptr) {
+        stats->Record(std::chrono::duration_cast<std::chrono::microseconds>(now - begin), overrun, skipped);
+    }
+    return next;
+}
@@ -0,0 +1,102 @@
+#ifndef TICKCLOCK_H
+#define TICKCLOCK_H
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+struct FixedRate {
+    //What to do when a tick ends after the next deadline has already passed
+    enum class Overrun {
+        Skip, //Drop the missed ticks and stay on the original grid
+        CatchUp, //Run the missed ticks back to back, at most maxCatchUp of them before resynchronizing
+        Stretch, //Restart the grid from the end of the late tick
+    };
+
+    //Rates come from events.yml unchecked: zero, negative and NaN fall back to DefaultFrequency, the rest is clamped
+    static constexpr float DefaultFrequency = 60;
+    static constexpr float MinFrequency = 0.1f;
+    static constexpr float MaxFrequency = 1000;
+
+    std::chrono::microseconds interval;
+    float frequency;
+    Overrun overrun;
+    int maxCatchUp = 5;
+
+    FixedRate(float freq, Overrun overrun = Overrun::Skip): overrun(overrun) {
+        SetFrequency(freq);
+    }
+
+    void SetFrequency(float freq) {
+        frequency = freq > 0 ? std::clamp(freq, MinFrequency, MaxFrequency) : DefaultFrequency;
+        interval = std::chrono::microseconds(static_cast<int>(1'000'000 / frequency));
+    }
+
+    static std::string OverrunToString(Overrun overrun);
+
+    static Overrun OverrunFromString(const std::string&overrun);
+};
+
+//Tick duration histogram with power-of-two microsecond buckets, written by the tick owner and readable from any thread
+class TickStats {
+public:
+    static constexpr size_t Buckets = 16;
+
+    struct Snapshot {
+        std::array<uint64_t, Buckets> histogram;
+        uint64_t ticks;
+        uint64_t overruns;
+        uint64_t skipped;
+        int64_t maxMicroseconds;
+        double meanMicroseconds;
+    };
+
+    void Record(std::chrono::microseconds duration, bool overrun, uint64_t skipped);
+
+    Snapshot GetSnapshot() const;
+
+    //Upper bound of a bucket, e.g. "<128us"
+    static std::string BucketLabel(size_t bucket);
+
+    //The non-empty buckets as "<128us:12 <256us:3"
+    static std::string HistogramText(const Snapshot&snapshot);
+
+private:
+    std::array<std::atomic<uint64_t>, Buckets> histogram{};
+    std::atomic<uint64_t> ticks = 0;
+    std::atomic<uint64_t> overruns = 0;
+    std::atomic<uint64_t> skipped = 0;
+    std::atomic<int64_t> maxMicroseconds = 0;
+    std::atomic<int64_t> totalMicroseconds = 0;
+};
+
+//Absolute-deadline tick clock: deadlines advance on a fixed grid so work time never accumulates as drift
+class TickClock {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TickClock(const FixedRate&rate);
+
+    void Reset(Clock::time_point now);
+
+    //Marks the start of a tick and returns the measured time since the previous one in seconds
+    float Begin(Clock::time_point now);
+
+    //Marks the end of a tick, records it and returns the deadline of the next one
+    Clock::time_point End(Clock::time_point now, TickStats* stats = nullptr);
+
+    const FixedRate& Rate() const {
+        return rate;
+    }
+
+private:
+    FixedRate rate;
+    Clock::time_point next;
+    Clock::time_point previousBegin;
+    Clock::time_point begin;
+    bool first = true;
+};
+
+
+#endif //TICKCLOCK_H
@@ -1,11 +1,14 @@
 #include <iostream>
 
 #include "ScriptManager.h"
+#include "Scheduler.h"
+#include "TickClock.h"
 #include <yaml-cpp/yaml.h>
 #include <chrono>
 
 #include "Encryption.h"
 #include "LoadManager.h"
+#include "ReplayRepository.h"
 #include "../MUI/GUIManifest.h"
 #include "../MUI/Application.h"
 #include "../MUI/Variables.h"
@@ -56,16 +59,6 @@ size_t streamJsonEg(void* contents, size_t size, size_t nmemb, void* userp) {
     return newLength;
 }
 
-struct FixedRate {
-    const std::chrono::microseconds interval;
-    const float frequency;
-
-    FixedRate(float freq)
-        : interval(std::chrono::microseconds(static_cast<int>(1'000'000 / freq))),
-          frequency(freq) {
-    }
-};
-
 struct AutomationTask {
     enum State {
         Recording,
@@ -90,53 +83,51 @@ struct AutomationTask {
 
     std::shared_ptr<std::string> Device = std::make_shared<std::string>("");
     std::shared_ptr<std::string> RunningScript = std::make_shared<std::string>("");
+    //Only filled from an older events.yml, moved into the replay repository at startup
     std::map<std::string, std::vector<AndroidEvent>> Replays;
     std::atomic<bool> running;
     std::thread ScriptThread;
     std::thread RecordingThread;
-    std::atomic<State> state;
+    std::atomic<State> state = Idle;
+    std::weak_ptr<Script> Instance;
+    FixedRate Rate = FixedRate(60);
+    std::shared_ptr<TickStats> Stats;
 
     static std::shared_ptr<AutomationTask> Create() {
         return std::make_shared<AutomationTask>();
     }
 };
 
-void Task(std::shared_ptr<Script>&script, std::atomic<bool>&running, FixedRate&fr,
-          std::shared_ptr<ADBC::ADBClient> adbc, std::atomic<AutomationTask::State>&state) {
-    state = AutomationTask::Awaking;
-    script->Invoke("Awake");
-    state = AutomationTask::Starting;
-    script->Invoke("Start", adbc);
-    state = AutomationTask::Updating;
-    while (running) {
-        script->Invoke("Update", 1.f / fr.frequency);
-
-        std::this_thread::sleep_for(fr.interval);
+AutomationTask::State toTaskState(Scheduler::Stage stage) {
+    switch (stage) {
+        case Scheduler::Stage::Awaking: return AutomationTask::Awaking;
+        case Scheduler::Stage::Starting: return AutomationTask::Starting;
+        case Scheduler::Stage::Updating: return AutomationTask::Updating;
+        case Scheduler::Stage::Stopping: return AutomationTask::Stopping;
+        default: return AutomationTask::Idle;
     }
-    state = AutomationTask::Stopping;
-    script->Invoke("OnDestroy");
 }
 
 template<>
-struct YAML::convert<std::shared_ptr<AutomationTask>> {
-    static Node encode(const std::shared_ptr<AutomationTask>&rhs) {
-        Node node;
-        node["Device"] = *rhs->Device;
-        node["Replays"] = rhs->Replays;
-        return node;
-    }
-
-    static bool decode(const Node&node, std::shared_ptr<AutomationTask>&rhs) {
-        if (!node.IsMap())
-            return false;
-        rhs = AutomationTask::Create();
-        *rhs->Device = node["Device"].as<std::string>();
-        if (!node["Replays"].IsDefined() && !node["Replays"].IsNull())
-            rhs->Replays = {};
-        else
-            rhs->Replays = node["Replays"].as<std::map<std::string, std::vector<AndroidEvent>>>();
-        return true;
-    }
+struct Reflection::Describe<AutomationTask> {
+    static constexpr auto fields = std::make_tuple(
+        property<AutomationTask, std::string>("Device",
+                                              [](const AutomationTask&task) { return *task.Device; },
+                                              [](AutomationTask&task, std::string device) {
+                                                  *task.Device = std::move(device);
+                                              }),
+        property<AutomationTask, float>("Rate",
+                                        [](const AutomationTask&task) { return task.Rate.frequency; },
+                                        [](AutomationTask&task, float rate) { task.Rate.SetFrequency(rate); }),
+        property<AutomationTask, std::string>("Overrun",
+                                              [](const AutomationTask&task) {
+                                                  return FixedRate::OverrunToString(task.Rate.overrun);
+                                              },
+                                              [](AutomationTask&task, std::string overrun) {
+                                                  task.Rate.overrun = FixedRate::OverrunFromString(overrun);
+                                              }),
+        //Replays live in replays.bin, older files that still carry them are read and migrated at startup
+        field("Replays", &AutomationTask::Replays, ReadOnly));
 };
 
 int main(int argc, char** argv) {
@@ -156,12 +147,49 @@ int main(int argc, char** argv) {
         tasks = LoadManager::Load<std::vector<std::shared_ptr<AutomationTask>>>("events.yml");
     else
         tasks = {};
+    //Only the index is read here, recordings are decoded when they are replayed
+    ReplayRepository replays("replays.bin");
+    if (!replays.Open()) {
+        //Running on would have the shutdown save replace the library that could not be read
+        std::cerr << "Failed to open replays.bin, fix or move it and its journal away before starting again" <<
+                std::endl;
+        return 1;
+    }
+    bool migrated = false;
+    bool unmigrated = false;
+    for (auto&task: tasks) {
+        for (auto it = task->Replays.begin(); it != task->Replays.end();) {
+            if (replays.Put(*task->Device, it->first, it->second)) {
+                it = task->Replays.erase(it);
+                migrated = true;
+            }
+            else {
+                ++it;
+                unmigrated = true;
+            }
+        }
+    }
+    //The replays are journaled now, drop them from events.yml so a crash cannot migrate stale copies again. If one
+    //could not be journaled, events.yml stays as it is so that the next start tries again
+    if (unmigrated)
+        std::cerr << "Failed to migrate replays from events.yml, leaving it unchanged" << std::endl;
+    else if (migrated)
+        LoadManager::Save(tasks, "events.yml");
+    for (const auto&info: replays.List()) {
+        if (std::ranges::none_of(tasks, [&](const std::shared_ptr<AutomationTask>&it) {
+            return *it->Device == info.device;
+        })) {
+            tasks.push_back(AutomationTask::Create());
+            *tasks.back()->Device = info.device;
+        }
+    }
     std::vector<AndroidEvent> ret;
 
     ScriptManager sm;
-    FixedRate fr(60);
+    Scheduler scheduler;
     sm.Adds(ScriptManager::Scan());
     sm.Initialize();
+    sm.EnableHotReload();
 
     Application app("Mio Framework", "");
     app.Initialize();
@@ -180,10 +208,8 @@ int main(int argc, char** argv) {
     auto search = manifest->GetUI<InputText>("SearchInputText");
     auto runningList = manifest->GetUI<ListBox>("RunningList");
     auto console = manifest->GetUI<Console>("ConsoleLog");
-    for (auto&task: tasks) {
-        for (auto&it: task->Replays)
-            RecordingList->GetData().items.push_back(it.first);
-    }
+    for (const auto&info: replays.List())
+        RecordingList->GetData().items.push_back(info.name);
     std::vector<std::string> scripts;
     Event::Modify("SearchScripts", [&] {
         for (auto&it: scripts) {
@@ -202,13 +228,15 @@ int main(int argc, char** argv) {
         }
     });
     Event::Modify("BtnConfirm", [&]() {
-        RecordingList->GetData().items.push_back(iptName->GetValue());
         auto item = std::ranges::find_if(
             tasks, [&](const std::shared_ptr<AutomationTask>&it) {
                 return *it->Device == DevicesBox->GetSelectedItem();
             });
         if (item != tasks.end()) {
-            (*item)->Replays[iptName->GetValue()] = ret;
+            if (replays.Put(*(*item)->Device, iptName->GetValue(), ret))
+                RecordingList->GetData().items.push_back(iptName->GetValue());
+            else
+                console->AddLog({"保存录制失败", Console::LogData::LogWarning});
         }
         window2->SetActive(false);
     });
@@ -250,7 +278,12 @@ int main(int argc, char** argv) {
         task->RecordingThread = std::thread([task,adbc,console]() {
             console->AddLog({"开始录制行为", Console::LogData::LogInfo});
             adbc->setID(*task->Device);
-            adbc->startRecordingAct();
+            adbc->startRecordingAct([task, console](const ADBC::AndroidEvent&event) {
+                console->AddLog({
+                    *task->Device + ": " + event.type + " " + std::to_string(event.points.size()) + "点 " +
+                    std::to_string(event.end - event.start) + "s", Console::LogData::LogInfo
+                });
+            });
         });
         task->RecordingThread.detach();
         tasks.push_back(task);
@@ -291,18 +324,25 @@ int main(int argc, char** argv) {
                 *item->get()->Device + ":开始回放行为: " + *item->get()->RunningScript, Console::LogData::LogInfo
             });
 
-            item->get()->ScriptThread = std::thread([item,adbc,console,RecordingList] {
+            item->get()->ScriptThread = std::thread([item,adbc,console,RecordingList,&replays] {
                 adbc->setID(*item->get()->Device);
                 item->get()->state = AutomationTask::State::Updating;
-                if (item->get()->Replays.contains(*item->get()->RunningScript)) {
-                    std::string name = *item->get()->RunningScript;
+                if (auto events = replays.Get(*item->get()->Device, *item->get()->RunningScript)) {
                     item->get()->running = true;
                     while (item->get()->state == AutomationTask::State::Updating) {
-                        adbc->ReplayEvents(item->get()->Replays[name], item->get()->running);
+                        auto report = adbc->ReplayEvents(*events, item->get()->running);
                         console->AddLog({
                             *item->get()->Device + ":回放完成: " + *item->get()->RunningScript,
                             Console::LogData::LogInfo
                         });
+                        console->AddLog({
+                            *item->get()->Device + ":回放时长 " + std::to_string(report.actualDuration) + "s/" +
+                            std::to_string(report.plannedDuration) + "s 平均误差 " +
+                            std::to_string(report.MeanError() * 1000) + "ms 最大误差 " +
+                            std::to_string(report.MaxError() * 1000) + "ms 延迟 " +
+                            std::to_string(report.latency * 1000) + "ms",
+                            Console::LogData::LogInfo
+                        });
                         item->get()->state = AutomationTask::State::Idle;
                     }
                 }
@@ -323,6 +363,55 @@ int main(int argc, char** argv) {
             item->get()->running = false;
         }
     });
+    Event::Modify("BtnBroadcast", [&] {
+        if (DevicesBox->GetData().items.empty()) {
+            window3->SetActive(true);
+            WarningText->GetData().text = "暂无可用设备";
+            console->AddLog({"目前没有可用设备", Console::LogData::LogWarning});
+            return;
+        }
+        //The selected device recorded the replay, its resolution is what the others are scaled from
+        const std::string source = DevicesBox->GetSelectedItem();
+        const std::string name = RecordingList->GetSelectedItem();
+        auto events = replays.Get(source, name);
+        if (!events) {
+            console->AddLog({source + ":没有回放: " + name, Console::LogData::LogWarning});
+            return;
+        }
+        std::vector<std::string> serials = DevicesBox->GetData().items;
+        console->AddLog({
+            "开始同步回放: " + name + " (" + std::to_string(serials.size()) + " 台设备)", Console::LogData::LogInfo
+        });
+        std::thread([serials, source, name, events, console] {
+            const std::string adbPath = RC::Utils::File::PlatformPath("bin/platform-tools/adb");
+            Resolution resolution(0, 0);
+            try {
+                resolution = ADBClient::Create(adbPath, source)->getResolution();
+            }
+            catch (const std::exception&e) {
+                console->AddLog({source + ":无法获取分辨率, 不缩放: " + e.what(), Console::LogData::LogWarning});
+            }
+            auto report = ADBClient::Broadcast(adbPath, serials, *events, resolution);
+            for (const auto&device: report.devices) {
+                if (!device.ok()) {
+                    console->AddLog({device.serial + ":同步回放失败: " + device.error, Console::LogData::LogWarning});
+                    continue;
+                }
+                console->AddLog({
+                    device.serial + ":同步回放完成 " + std::to_string(device.completion) + "s 平均误差 " +
+                    std::to_string(device.replay.MeanError() * 1000) + "ms 延迟 " +
+                    std::to_string(device.replay.latency * 1000) + "ms",
+                    Console::LogData::LogInfo
+                });
+            }
+            console->AddLog({
+                "同步回放完成: " + name + " 准备 " + std::to_string(report.preparation) + "s 开始偏差 " +
+                std::to_string(report.StartSkew() * 1000) + "ms 完成偏差 " +
+                std::to_string(report.CompletionSkew() * 1000) + "ms",
+                Console::LogData::LogInfo
+            });
+        }).detach();
+    });
     Event::Modify("BtnRun", [&] {
         if (DevicesBox->GetData().items.empty()) {
             window3->SetActive(true);
@@ -339,20 +428,69 @@ int main(int argc, char** argv) {
             tasks.emplace_back(task);
             item = tasks.end() - 1;
         }
+        //A stopped script keeps its instance until its job reaches Finished, which can take as long as a Sleep in
+        //progress. Starting before that would drive the same lua_State from two jobs.
+        if (item->get()->running || item->get()->state != AutomationTask::Idle) {
+            console->AddLog({*item->get()->Device + ":脚本仍在运行", Console::LogData::LogWarning});
+            return;
+        }
         *item->get()->RunningScript = RC::Utils::File::FileName(scriptsList->GetSelectedItem());
         console->AddLog({
             *item->get()->Device + ":开始运行脚本: " + *item->get()->RunningScript, Console::LogData::LogInfo
         });
         item->get()->running = true;
-        item->get()->ScriptThread = std::thread([item,adbc,&sm,scriptsList,&fr] {
-            auto script = sm.GetScript(RC::Utils::File::FileName(scriptsList->GetSelectedItem()));
-
-            adbc->setID(*item->get()->Device);
-            Task(script, item->get()->running, fr, adbc, item->get()->state);
+        auto script = sm.Acquire(*item->get()->RunningScript, *item->get()->Device);
+        if (script == nullptr) {
+            console->AddLog({"脚本未加载: " + *item->get()->RunningScript, Console::LogData::LogWarning});
+            item->get()->running = false;
+            return;
+        }
+        item->get()->Instance = script;
+        //Only the device client is created on a short-lived thread, the script itself runs on the scheduler
+        item->get()->Stats = std::make_shared<TickStats>();
+        item->get()->ScriptThread = std::thread([task = *item, script, stats = item->get()->Stats, &scheduler, &sm,
+                                                 &replays] {
+            auto client = ADBClient::Create(RC::Utils::File::PlatformPath("bin/platform-tools/adb"), *task->Device);
+            client->setEventSource([&replays, device = *task->Device](const std::string&name) {
+                auto events = replays.Get(device, name);
+                return events ? *events : std::vector<AndroidEvent>{};
+            });
+            scheduler.Spawn(script, client, task->Rate, [task] { return task->running.load(); },
+                            [task, script, &sm](Scheduler::Stage stage) {
+                                task->state = toTaskState(stage);
+                                if (stage == Scheduler::Stage::Finished) {
+                                    sm.Release(*task->RunningScript, *task->Device, script);
+                                }
+                            }, stats);
         });
 
         item->get()->ScriptThread.detach();
     });
+    Event::Modify("BtnProfile", [&] {
+        auto item = std::ranges::find_if(
+            tasks, [&](const std::shared_ptr<AutomationTask>&it) {
+                return *it->Device == DevicesBox->GetSelectedItem();
+            });
+        if (item == tasks.end()) {
+            return;
+        }
+        auto instance = item->get()->Instance.lock();
+        if (instance == nullptr) {
+            console->AddLog({*item->get()->Device + ":没有正在运行的脚本", Console::LogData::LogWarning});
+            return;
+        }
+        if (instance->IsProfiling()) {
+            RC::Utils::Directory::Create("assets/profile");
+            std::string path = "assets/profile/" + *item->get()->Device + "_" + *item->get()->RunningScript;
+            std::ranges::replace(path, ':', '_');
+            instance->RequestProfiling(false, path);
+            console->AddLog({*item->get()->Device + ":性能分析已保存: " + path, Console::LogData::LogInfo});
+        }
+        else {
+            instance->RequestProfiling(true);
+            console->AddLog({*item->get()->Device + ":开始性能分析", Console::LogData::LogInfo});
+        }
+    });
     Event::Modify("BtnStopRun", [&] {
         if (DevicesBox->GetData().items.empty()) {
             window3->SetActive(true);
@@ -375,15 +513,36 @@ int main(int argc, char** argv) {
     while (!app.ShouldClose()) {
         runningList->GetData().items.clear();
         for (const auto&task: tasks) {
+            std::string memory;
+            if (auto instance = task->Instance.lock()) {
+                auto stats = instance->GetMemoryStats();
+                memory = ": " + std::to_string(stats.live / 1024) + "KB (peak " + std::to_string(stats.peak / 1024) +
+                         "KB)";
+            }
+            std::string ticks;
+            if (task->Stats && task->state == AutomationTask::Updating) {
+                auto stats = task->Stats->GetSnapshot();
+                char buffer[96];
+                std::snprintf(buffer, sizeof(buffer), ": %.0fHz avg %.2fms max %.2fms overrun %llu",
+                              task->Rate.frequency, stats.meanMicroseconds / 1000.0, stats.maxMicroseconds / 1000.0,
+                              static_cast<unsigned long long>(stats.overruns));
+                ticks = buffer;
+                if (const std::string histogram = TickStats::HistogramText(stats); !histogram.empty()) {
+                    ticks += " [" + histogram + "]";
+                }
+            }
             runningList->GetData().items.emplace_back(
                 *task.get()->Device + ": " + *task.get()->RunningScript + ": " + AutomationTask::stateToString(
-                    task.get()->state));
+                    task.get()->state) + memory + ticks);
         }
         app.SetClearColor(clear);
         app.Update();
     }
 
-    LoadManager::Save(tasks, "events.yml");
+    replays.Save();
+    //Replays are never written back, saving now would drop the ones that are still waiting to be migrated
+    if (!unmigrated)
+        LoadManager::Save(tasks, "events.yml");
     //Resource.Pack();
     app.Shutdown();
     if (RC::Utils::File::Exists("Resources"))
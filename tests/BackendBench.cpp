@@ -0,0 +1,166 @@
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+#include "Bench.h"
+#include "ScriptFixture.h"
+
+//Representative per-tick script work, built against whichever backend MIO_USE_LUAJIT selects; compare the output of
+//a Lua and a LuaJIT build. Under LuaJIT the frame and point loops also run through the mio.ffi views.
+namespace {
+    const char* Source = R"(
+local jit = rawget(_G, "jit")
+local view = jit and require("mio.ffi") or nil
+
+function Backend()
+    return jit and jit.version or _VERSION
+end
+
+function HasFFI()
+    return view ~= nil
+end
+
+--Non-maximum suppression over 2000 random boxes
+function ScoreDetections()
+    local seed = 42
+    local function rand()
+        seed = (seed * 16807) % 2147483647
+        return seed / 2147483647
+    end
+    local boxes = {}
+    for i = 1, 2000 do
+        boxes[i] = {x = rand() * 600, y = rand() * 440, w = 20 + rand() * 20, h = 20 + rand() * 20, score = rand()}
+    end
+    table.sort(boxes, function(a, b) return a.score > b.score end)
+    local kept = {}
+    for i = 1, #boxes do
+        local a = boxes[i]
+        local keep = true
+        for j = 1, #kept do
+            local b = kept[j]
+            local ix = math.max(0, math.min(a.x + a.w, b.x + b.w) - math.max(a.x, b.x))
+            local iy = math.max(0, math.min(a.y + a.h, b.y + b.h) - math.max(a.y, b.y))
+            local inter = ix * iy
+            if inter / (a.w * a.h + b.w * b.h - inter) > 0.3 then
+                keep = false
+                break
+            end
+        end
+        if keep then
+            kept[#kept + 1] = a
+        end
+    end
+    return #kept
+end
+
+--Breadth-first search across a 128x128 grid with walls
+function PlanPath()
+    local size = 128
+    local blocked = {}
+    for y = 0, size - 1 do
+        for x = 0, size - 1 do
+            blocked[y * size + x] = x % 16 == 8 and y % 32 ~= (x % 32 == 8 and 0 or 31)
+        end
+    end
+    local dist = {[0] = 0}
+    local queue, head, tail = {0}, 1, 1
+    while head <= tail do
+        local cell = queue[head]
+        head = head + 1
+        local x, y = cell % size, math.floor(cell / size)
+        local neighbours = {
+            x > 0 and cell - 1, x < size - 1 and cell + 1, y > 0 and cell - size, y < size - 1 and cell + size
+        }
+        for i = 1, 4 do
+            local next = neighbours[i]
+            if next and not blocked[next] and dist[next] == nil then
+                dist[next] = dist[cell] + 1
+                tail = tail + 1
+                queue[tail] = next
+            end
+        end
+    end
+    return dist[size * size - 1]
+end
+
+function SetPoints(values)
+    points = values
+end
+
+--Path length over {time, x, y} triples copied into a table
+function PathLengthTable()
+    local total = 0
+    for i = 4, #points, 3 do
+        local dx, dy = points[i + 1] - points[i - 2], points[i + 2] - points[i - 1]
+        total = total + math.sqrt(dx * dx + dy * dy)
+    end
+    return total
+end
+
+function SetEvent(value)
+    event = value
+end
+
+function PathLengthFFI()
+    local p, n = view.points(event)
+    local total = 0
+    for i = 1, n - 1 do
+        local dx, dy = p[i].x - p[i - 1].x, p[i].y - p[i - 1].y
+        total = total + math.sqrt(dx * dx + dy * dy)
+    end
+    return total
+end
+
+function SetFrame(value)
+    frame = value
+end
+
+function SumPixelsFFI()
+    local data, step, rows, cols, channels = view.pixels(frame)
+    local total = 0
+    for y = 0, rows - 1 do
+        local row = data + y * step
+        for x = 0, cols * channels - 1 do
+            total = total + row[x]
+        end
+    end
+    return total
+end
+)";
+}
+
+int main(int argc, char** argv) {
+    Bench::Init(argc, argv);
+    auto script = LoadScript("backend-bench", Source);
+    if (!script) {
+        std::cerr << "Failed to load the benchmark script" << std::endl;
+        return 1;
+    }
+    std::printf("backend: %s\n", script->Invoke("Backend").as<std::string>().c_str());
+    Bench::Measure("detections, NMS over 2000 boxes", 100, [&] { script->Invoke("ScoreDetections"); });
+    Bench::Measure("path planning, BFS on 128x128", 100, [&] { script->Invoke("PlanPath"); });
+
+    ADBC::AndroidEvent event;
+    event.type = "swipe";
+    std::vector<float> flat;
+    for (int i = 0; i < 5000; i++) {
+        const float t = i * 0.002f;
+        const ADBC::Point p{500 + 300 * std::cos(t * 3), 900 + 300 * std::sin(t * 2)};
+        event.points.emplace_back(t, p);
+        flat.insert(flat.end(), {t, p.x, p.y});
+    }
+    Bench::Measure("points, copy into a table", 200, [&] { script->Invoke("SetPoints", sol::as_table(flat)); });
+    Bench::Measure("points, path length over the table", 200, [&] { script->Invoke("PathLengthTable"); });
+    if (!script->Invoke("HasFFI").as<bool>()) {
+        std::printf("no FFI on this backend, frame and point views skipped\n");
+        return 0;
+    }
+    script->Invoke("SetEvent", event);
+    Bench::Measure("points, path length through mio.ffi", 200, [&] { script->Invoke("PathLengthFFI"); });
+    cv::Mat frame(480, 640, CV_8UC3);
+    cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+    script->Invoke("SetFrame", frame);
+    Bench::Measure("frame, pixel sum through mio.ffi", 20, [&] { script->Invoke("SumPixelsFFI"); });
+    return 0;
+}
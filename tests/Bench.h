@@ -0,0 +1,42 @@
+#ifndef BENCH_H
+#define BENCH_H
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string_view>
+
+//Timing loop for the benchmark executables. Started by hand they measure the given iterations, ctest passes --quick
+//so that every benchmark still builds and runs once per test pass without costing real time.
+namespace Bench {
+    inline bool quick = false;
+    inline volatile size_t sink = 0;
+
+    inline void Init(int argc, char** argv) {
+        quick = argc > 1 && std::string_view(argv[1]) == "--quick";
+    }
+
+    //Keeps a result alive so the measured work cannot be optimized away
+    inline void Keep(size_t value) {
+        sink = sink + value;
+    }
+
+    //Runs body once to warm up, then iterations times, and prints the time per iteration in microseconds
+    template<typename F>
+    double Measure(const char* name, size_t iterations, F&&body) {
+        if (quick) {
+            iterations = std::max<size_t>(1, iterations / 100);
+        }
+        body();
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++) {
+            body();
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const double micros = seconds * 1e6 / static_cast<double>(iterations);
+        std::printf("%-48s %12.3f us  (%zu iterations)\n", name, micros, iterations);
+        return micros;
+    }
+}
+
+
+#endif //BENCH_H
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ADBClient.h"
+#include "Check.h"
+#include "InputEventDecoder.h"
+
+using namespace ADBC;
+
+//Broadcast onto fake-adb devices, see fake-adb.sh
+namespace {
+    const auto Root = std::filesystem::temp_directory_path() / "mio-tests" / "broadcast";
+
+    std::string readLog(const std::string&serial, const std::string&name) {
+        std::stringstream log;
+        log << std::ifstream(Root / serial / name).rdbuf();
+        return log.str();
+    }
+
+    std::string inputLog(const std::string&serial) {
+        return readLog(serial, "input.log");
+    }
+}
+
+int main() {
+    std::filesystem::remove_all(Root);
+    std::filesystem::create_directories(Root);
+    setenv("MIO_FAKE_ADB_ROOT", Root.c_str(), 1);
+    const std::string adb = "sh " MIO_FAKE_ADB;
+
+    //A swipe across the screen followed by a tap in its middle, recorded on 1080x1920
+    AndroidEvent swipe;
+    swipe.type = "swipe";
+    for (int i = 0; i <= 10; i++) {
+        swipe.points.emplace_back(i * 0.03f, Point{100 + i * 90.0f, 200 + i * 160.0f});
+    }
+    swipe.start = 0;
+    swipe.end = 0.3f;
+    AndroidEvent tap;
+    tap.type = "tap";
+    tap.points = {{0.5f, {540, 960}}};
+    tap.start = tap.end = 0.5f;
+
+    std::vector<std::string> serials;
+    for (int i = 0; i < 16; i++) {
+        serials.push_back((i % 2 ? "small-" : "large-") + std::to_string(i));
+    }
+    serials.insert(serials.begin() + 5, "offline-1");
+    const auto report = ADBClient::Broadcast(adb, serials, {swipe, tap}, Resolution(1080, 1920));
+
+    //The unreachable device is reported and left out, the others all ran
+    CHECK(report.devices.size() == serials.size());
+    for (size_t i = 0; i < serials.size(); i++) {
+        const auto&device = report.devices[i];
+        CHECK(device.serial == serials[i]);
+        if (serials[i].starts_with("offline")) {
+            CHECK(!device.ok());
+            CHECK(device.completion < 0);
+            continue;
+        }
+        CHECK(device.ok());
+        CHECK(device.replay.events.size() == 2);
+        //The tap is dispatched ahead by the measured latency
+        CHECK(device.completion > 0.4f);
+
+        //The swipe reached the panel as raw input in panel coordinates, the tap through input in screen ones
+        const auto records = InputEventDecoder::DecodeDump((Root / serials[i] / "event2").string(),
+                                                           InputEventDecoder::Layout::Timeval64);
+        int32_t lastX = -1;
+        size_t reports = 0;
+        for (const auto&record: records) {
+            if (record.type == Input::EV_ABS && record.code == Input::ABS_MT_POSITION_X) {
+                lastX = record.value;
+            }
+            reports += record.type == Input::EV_SYN;
+        }
+        //One frame per sample, the finger lifts in the last one
+        CHECK(reports == swipe.points.size());
+        CHECK(!records.empty() && records[records.size() - 3].code == Input::ABS_MT_TRACKING_ID &&
+              records[records.size() - 3].value == -1);
+        CHECK(std::abs(lastX - 1000 * 4095 / 1080) <= 1);
+        const bool small = serials[i].starts_with("small");
+        CHECK(inputLog(serials[i]).find(small ? "input tap 360.0" : "input tap 540.0") != std::string::npos);
+    }
+
+    //Released together: devices start and finish within a fraction of the replay of each other
+    CHECK(report.preparation > 0);
+    CHECK(report.StartSkew() < 0.2f);
+    CHECK(report.CompletionSkew() < 0.3f);
+
+    //Nothing to do without devices or events
+    CHECK(ADBClient::Broadcast(adb, {}, {swipe}).devices.empty());
+    CHECK(ADBClient::Broadcast(adb, {"large-0"}, {}).devices.size() == 1);
+
+    //Replaying the same events again reuses the injector pushed the first time
+    const auto client = ADBClient::Create(adb, "large-replay");
+    const auto first = client->ReplayEvents({swipe, tap});
+    const auto second = client->ReplayEvents({swipe, tap});
+    CHECK(first.events.size() == 2 && second.events.size() == 2);
+    CHECK(std::ranges::count(readLog("large-replay", "push.log"), '\n') == 2);
+    size_t frames = 0;
+    for (const auto&record: InputEventDecoder::DecodeDump((Root / "large-replay" / "event2").string(),
+                                                          InputEventDecoder::Layout::Timeval64)) {
+        frames += record.type == Input::EV_SYN;
+    }
+    CHECK(frames == 2 * swipe.points.size());
+    //Frames keep to their offsets from the start of the injector, the swipe lasts as long as it was recorded
+    CHECK(second.actualDuration >= swipe.end);
+
+    //Gestures overlapping in time are injected by the same script on separate slots and tracking ids
+    AndroidEvent overlapping = swipe;
+    for (auto&[time, point]: overlapping.points) {
+        time += 0.1f;
+        point.x = 1000 - point.x;
+    }
+    overlapping.start += 0.1f;
+    overlapping.end += 0.1f;
+    const auto other = ADBClient::Create(adb, "large-overlap");
+    CHECK(other->ReplayEvents({swipe, overlapping}).events.size() == 2);
+    CHECK(std::ranges::count(readLog("large-overlap", "push.log"), '\n') == 2);
+    std::vector<int32_t> slots, ids;
+    for (const auto&record: InputEventDecoder::DecodeDump((Root / "large-overlap" / "event2").string(),
+                                                          InputEventDecoder::Layout::Timeval64)) {
+        if (record.type == Input::EV_ABS && record.code == Input::ABS_MT_SLOT) {
+            slots.push_back(record.value);
+        }
+        if (record.type == Input::EV_ABS && record.code == Input::ABS_MT_TRACKING_ID && record.value >= 0) {
+            ids.push_back(record.value);
+        }
+    }
+    CHECK(std::ranges::count(slots, 1) > 0);
+    CHECK(ids.size() == 2 && ids[0] != ids[1]);
+
+    std::filesystem::remove_all(Root);
+    return Check::Result();
+}
@@ -0,0 +1,28 @@
+#ifndef CHECK_H
+#define CHECK_H
+#include <cmath>
+#include <iostream>
+
+//Minimal assertions for the test executables. A failed check is reported and counted instead of aborting, so one
+//run lists every failure; main returns Check::Result().
+namespace Check {
+    inline int failures = 0;
+
+    inline void Fail(const char* expression, const char* file, int line) {
+        std::cerr << file << ":" << line << ": check failed: " << expression << std::endl;
+        failures++;
+    }
+
+    inline int Result() {
+        if (failures > 0) {
+            std::cerr << failures << " check(s) failed" << std::endl;
+        }
+        return failures == 0 ? 0 : 1;
+    }
+}
+
+#define CHECK(expression) ((expression) ? static_cast<void>(0) : Check::Fail(#expression, __FILE__, __LINE__))
+#define CHECK_NEAR(a, b, tolerance) CHECK(std::abs((a) - (b)) <= (tolerance))
+
+
+#endif //CHECK_H
@@ -0,0 +1,93 @@
+#include <cstdio>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "GeteventParser.h"
+
+using namespace ADBC;
+
+//A two finger swipe as getevent -t and -lt print it, against the regex, substr and stoi matching recordAct used to do
+namespace {
+    std::vector<std::string> captureLog(bool labels, size_t frames) {
+        std::vector<std::string> lines;
+        char line[160];
+        auto emit = [&](double time, const char* typeLabel, uint16_t type, const char* codeLabel, uint16_t code,
+                        int32_t value) {
+            if (labels) {
+                std::snprintf(line, sizeof(line), "[%14.6f] /dev/input/event2: %-12s %-20s %08x", time, typeLabel,
+                              codeLabel, static_cast<uint32_t>(value));
+            }
+            else {
+                std::snprintf(line, sizeof(line), "[%14.6f] /dev/input/event2: %04x %04x %08x", time, type, code,
+                              static_cast<uint32_t>(value));
+            }
+            lines.emplace_back(line);
+        };
+        double time = 86400.0;
+        for (size_t frame = 0; frame < frames; frame++, time += 0.008) {
+            for (int slot = 0; slot < 2; slot++) {
+                emit(time, "EV_ABS", Input::EV_ABS, "ABS_MT_SLOT", Input::ABS_MT_SLOT, slot);
+                if (frame == 0) {
+                    emit(time, "EV_ABS", Input::EV_ABS, "ABS_MT_TRACKING_ID", Input::ABS_MT_TRACKING_ID, slot + 10);
+                }
+                emit(time, "EV_ABS", Input::EV_ABS, "ABS_MT_POSITION_X", Input::ABS_MT_POSITION_X,
+                     static_cast<int32_t>(200 + frame % 800 + slot * 300));
+                emit(time, "EV_ABS", Input::EV_ABS, "ABS_MT_POSITION_Y", Input::ABS_MT_POSITION_Y,
+                     static_cast<int32_t>(1600 - frame % 1200));
+                emit(time, "EV_ABS", Input::EV_ABS, "ABS_MT_TOUCH_MAJOR", Input::ABS_MT_TOUCH_MAJOR, 6);
+                emit(time, "EV_ABS", Input::EV_ABS, "ABS_MT_PRESSURE", Input::ABS_MT_PRESSURE, 40);
+            }
+            emit(time, "EV_SYN", Input::EV_SYN, "SYN_REPORT", Input::SYN_REPORT, 0);
+        }
+        return lines;
+    }
+
+    size_t parseAll(const std::vector<std::string>&lines) {
+        size_t sum = 0;
+        InputRecord record;
+        for (const auto&line: lines) {
+            if (ParseGeteventLine(line, record)) {
+                sum += record.code + static_cast<size_t>(record.value);
+            }
+        }
+        return sum;
+    }
+
+    //The per-line work recordAct did before ParseGeteventLine, for numeric lines only
+    size_t parseAllRegex(const std::vector<std::string>&lines) {
+        static const std::regex stamp(R"(\[\s*(\d+\.\d+)\])");
+        size_t sum = 0;
+        std::smatch match;
+        for (const auto&line: lines) {
+            if (!std::regex_search(line, match, stamp)) {
+                continue;
+            }
+            const double time = std::stod(match[1].str());
+            for (const char* code: {"0003 0035", "0003 0036", "0003 0039"}) {
+                const size_t at = line.find(code);
+                if (at != std::string::npos) {
+                    try {
+                        sum += static_cast<size_t>(std::stoi(line.substr(at + 10, 8), nullptr, 16));
+                    }
+                    catch (std::exception&) {
+                    }
+                }
+            }
+            sum += static_cast<size_t>(time);
+        }
+        return sum;
+    }
+}
+
+int main(int argc, char** argv) {
+    Bench::Init(argc, argv);
+    const auto numeric = captureLog(false, 10000);
+    const auto labelled = captureLog(true, 10000);
+    std::printf("%zu lines per pass\n", numeric.size());
+    Bench::Measure("getevent -t, ParseGeteventLine", 50, [&] { Bench::Keep(parseAll(numeric)); });
+    Bench::Measure("getevent -lt, ParseGeteventLine", 50, [&] { Bench::Keep(parseAll(labelled)); });
+    Bench::Measure("getevent -t, regex and stoi", 5, [&] { Bench::Keep(parseAllRegex(numeric)); });
+    return 0;
+}
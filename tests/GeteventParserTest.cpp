@@ -0,0 +1,86 @@
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "Check.h"
+#include "GeteventParser.h"
+
+using namespace ADBC;
+
+namespace {
+    bool parses(std::string_view line, uint16_t type, uint16_t code, int32_t value) {
+        InputRecord record;
+        return ParseGeteventLine(line, record) && record.type == type && record.code == code && record.value == value;
+    }
+}
+
+int main() {
+    InputRecord record;
+
+    //getevent -t, numeric
+    CHECK(ParseGeteventLine("[   12345.678901] /dev/input/event2: 0003 0035 000001a2", record));
+    CHECK_NEAR(record.time, 12345.678901, 1e-6);
+    CHECK(record.device == "/dev/input/event2");
+    CHECK(record.type == Input::EV_ABS);
+    CHECK(record.code == Input::ABS_MT_POSITION_X);
+    CHECK(record.value == 0x1a2);
+
+    //getevent -lt, symbolic, padded with spaces
+    CHECK(ParseGeteventLine("[   12345.678950] /dev/input/event2: EV_ABS       ABS_MT_POSITION_Y    00000384", record));
+    CHECK_NEAR(record.time, 12345.67895, 1e-6);
+    CHECK(record.type == Input::EV_ABS);
+    CHECK(record.code == Input::ABS_MT_POSITION_Y);
+    CHECK(record.value == 0x384);
+    CHECK(parses("[  1.000000] /dev/input/event2: EV_KEY       BTN_TOUCH            DOWN", Input::EV_KEY,
+                 Input::BTN_TOUCH, 1));
+    CHECK(parses("[  1.000000] /dev/input/event2: EV_KEY       BTN_TOUCH            UP", Input::EV_KEY,
+                 Input::BTN_TOUCH, 0));
+    CHECK(parses("[  1.000000] /dev/input/event2: EV_SYN       SYN_REPORT           00000000", Input::EV_SYN,
+                 Input::SYN_REPORT, 0));
+    CHECK(parses("[  1.000000] EV_SYN SYN_MT_REPORT 00000000", Input::EV_SYN, Input::SYN_MT_REPORT, 0));
+
+    //Without the device prefix, as printed by getevent -t on a single device
+    CHECK(ParseGeteventLine("[     7.5] 0001 014a 00000001", record));
+    CHECK(record.device.empty());
+    CHECK_NEAR(record.time, 7.5, 1e-9);
+    CHECK(record.type == Input::EV_KEY);
+    CHECK(record.code == Input::BTN_TOUCH);
+
+    //A lifted finger reports tracking id -1
+    CHECK(parses("[ 2.0] /dev/input/event2: 0003 0039 ffffffff", Input::EV_ABS, Input::ABS_MT_TRACKING_ID, -1));
+    CHECK(parses("[ 2.0] /dev/input/event2: EV_ABS ABS_MT_TRACKING_ID ffffffff", Input::EV_ABS,
+                 Input::ABS_MT_TRACKING_ID, -1));
+
+    //Every EV_ABS code, numeric and symbolic
+    const std::pair<const char*, uint16_t> codes[] = {
+        {"ABS_X", Input::ABS_X}, {"ABS_Y", Input::ABS_Y}, {"ABS_PRESSURE", Input::ABS_PRESSURE},
+        {"ABS_MT_SLOT", Input::ABS_MT_SLOT}, {"ABS_MT_TOUCH_MAJOR", Input::ABS_MT_TOUCH_MAJOR},
+        {"ABS_MT_TOUCH_MINOR", Input::ABS_MT_TOUCH_MINOR}, {"ABS_MT_WIDTH_MAJOR", Input::ABS_MT_WIDTH_MAJOR},
+        {"ABS_MT_WIDTH_MINOR", Input::ABS_MT_WIDTH_MINOR}, {"ABS_MT_ORIENTATION", Input::ABS_MT_ORIENTATION},
+        {"ABS_MT_POSITION_X", Input::ABS_MT_POSITION_X}, {"ABS_MT_POSITION_Y", Input::ABS_MT_POSITION_Y},
+        {"ABS_MT_TOOL_TYPE", Input::ABS_MT_TOOL_TYPE}, {"ABS_MT_BLOB_ID", Input::ABS_MT_BLOB_ID},
+        {"ABS_MT_TRACKING_ID", Input::ABS_MT_TRACKING_ID}, {"ABS_MT_PRESSURE", Input::ABS_MT_PRESSURE},
+        {"ABS_MT_DISTANCE", Input::ABS_MT_DISTANCE}, {"ABS_MT_TOOL_X", Input::ABS_MT_TOOL_X},
+        {"ABS_MT_TOOL_Y", Input::ABS_MT_TOOL_Y},
+    };
+    for (const auto&[name, code]: codes) {
+        char hex[5];
+        std::snprintf(hex, sizeof(hex), "%04x", code);
+        CHECK(parses("[ 3.25] /dev/input/event2: 0003 " + std::string(hex) + " 0000002a", Input::EV_ABS, code, 42));
+        CHECK(parses("[ 3.25] /dev/input/event2: EV_ABS " + std::string(name) + " 0000002a", Input::EV_ABS, code,
+                     42));
+    }
+
+    //Headers, blank and malformed lines
+    CHECK(!ParseGeteventLine("", record));
+    CHECK(!ParseGeteventLine("add device 1: /dev/input/event2", record));
+    CHECK(!ParseGeteventLine("  name:     \"touchscreen\"", record));
+    CHECK(!ParseGeteventLine("[ 1.0] /dev/input/event2: 0003 0035", record));
+    CHECK(!ParseGeteventLine("[ 1.0] /dev/input/event2: 0003 0035 xyz", record));
+    CHECK(!ParseGeteventLine("[ 1.0] /dev/input/event2: EV_FOO ABS_X 00000001", record));
+    CHECK(!ParseGeteventLine("[ 1.0] /dev/input/event2: 0003 0035 123456789", record));
+    CHECK(!ParseGeteventLine("[ abc] /dev/input/event2: 0003 0035 00000001", record));
+    CHECK(!ParseGeteventLine("[ 1.0 /dev/input/event2: 0003 0035 00000001", record));
+    return Check::Result();
+}
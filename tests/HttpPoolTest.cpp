@@ -0,0 +1,218 @@
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "Check.h"
+#include "HttpPool.h"
+
+//HttpPool against a small keep-alive HTTP/1.1 server on the loopback interface
+namespace {
+    class StandInServer {
+    public:
+        StandInServer() {
+            listener = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+            socklen_t length = sizeof(address);
+            getsockname(listener, reinterpret_cast<sockaddr *>(&address), &length);
+            port = ntohs(address.sin_port);
+            listen(listener, 64);
+            acceptor = std::thread(&StandInServer::acceptLoop, this);
+        }
+
+        ~StandInServer() {
+            shutdown(listener, SHUT_RDWR);
+            close(listener);
+            acceptor.join(); {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (int client: clients) {
+                    shutdown(client, SHUT_RDWR);
+                }
+            }
+            for (auto&thread: threads) {
+                thread.join();
+            }
+            for (int client: clients) {
+                close(client);
+            }
+        }
+
+        std::string Url(const std::string&path) const {
+            return "http://127.0.0.1:" + std::to_string(port) + path;
+        }
+
+        std::atomic<int> connections = 0;
+        std::atomic<int> active = 0;
+        std::atomic<int> maxActive = 0;
+
+    private:
+        void acceptLoop() {
+            while (true) {
+                const int client = accept(listener, nullptr, nullptr);
+                if (client < 0) {
+                    return;
+                }
+                connections++;
+                std::lock_guard<std::mutex> lock(mutex);
+                clients.push_back(client);
+                threads.emplace_back(&StandInServer::serve, this, client);
+            }
+        }
+
+        //Answers requests on one connection until the client closes it
+        void serve(int client) {
+            std::string buffer;
+            char chunk[4096];
+            while (true) {
+                size_t headerEnd;
+                while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+                    const ssize_t n = recv(client, chunk, sizeof(chunk), 0);
+                    if (n <= 0) {
+                        return;
+                    }
+                    buffer.append(chunk, n);
+                }
+                const std::string head = buffer.substr(0, headerEnd);
+                size_t contentLength = 0;
+                if (const size_t at = head.find("Content-Length: "); at != std::string::npos) {
+                    contentLength = std::stoul(head.substr(at + 16));
+                }
+                while (buffer.size() < headerEnd + 4 + contentLength) {
+                    const ssize_t n = recv(client, chunk, sizeof(chunk), 0);
+                    if (n <= 0) {
+                        return;
+                    }
+                    buffer.append(chunk, n);
+                }
+                const std::string body = buffer.substr(headerEnd + 4, contentLength);
+                buffer.erase(0, headerEnd + 4 + contentLength);
+
+                const std::string method = head.substr(0, head.find(' '));
+                const size_t pathStart = method.size() + 1;
+                const std::string path = head.substr(pathStart, head.find(' ', pathStart) - pathStart);
+                const int now = ++active;
+                int seen = maxActive;
+                while (now > seen && !maxActive.compare_exchange_weak(seen, now)) {
+                }
+                int status = 200;
+                std::string reply;
+                if (path == "/echo") {
+                    reply = method + ":" + body;
+                }
+                else if (path == "/slow") {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                    reply = "slow";
+                }
+                else if (path == "/header") {
+                    const size_t at = head.find("X-Mio: ");
+                    reply = at == std::string::npos ? "" : head.substr(at + 7, head.find("\r\n", at) - at - 7);
+                }
+                else {
+                    status = 404;
+                }
+                active--;
+                const std::string response = "HTTP/1.1 " + std::to_string(status) + (status == 200 ? " OK" : " Not Found")
+                                             + "\r\nContent-Length: " + std::to_string(reply.size()) + "\r\n\r\n" + reply;
+                if (send(client, response.data(), response.size(), MSG_NOSIGNAL) < 0) {
+                    return;
+                }
+            }
+        }
+
+        int listener;
+        int port;
+        std::thread acceptor;
+        std::mutex mutex;
+        std::vector<int> clients;
+        std::vector<std::thread> threads;
+    };
+}
+
+int main() {
+    StandInServer server;
+    auto&pool = HttpPool::Instance();
+
+    //Methods, bodies and headers
+    const auto get = pool.Submit({.url = server.Url("/echo")})->Get();
+    CHECK(get.ok());
+    CHECK(get.status == 200);
+    CHECK(get.body == "GET:");
+    const auto post = pool.Submit({.method = "POST", .url = server.Url("/echo"), .body = "payload"})->Get();
+    CHECK(post.body == "POST:payload");
+    const auto put = pool.Submit({.method = "PUT", .url = server.Url("/echo"), .body = "data"})->Get();
+    CHECK(put.body == "PUT:data");
+    const auto header = pool.Submit({.url = server.Url("/header"), .headers = {"X-Mio: 1"}})->Get();
+    CHECK(header.body == "1");
+    const auto missing = pool.Submit({.url = server.Url("/missing")})->Get();
+    CHECK(missing.status == 404);
+    CHECK(!missing.ok());
+
+    //Sequential requests reuse kept-alive connections instead of opening one each
+    const int before = server.connections;
+    for (int i = 0; i < 20; i++) {
+        CHECK(pool.Submit({.url = server.Url("/echo")})->Get().ok());
+    }
+    CHECK(server.connections - before < 20);
+
+    //No more requests in flight than the pool has workers, the rest wait in the queue
+    std::vector<std::shared_ptr<HttpPool::Call>> calls;
+    for (int i = 0; i < 12; i++) {
+        calls.push_back(pool.Submit({.url = server.Url("/slow")}));
+    }
+    CHECK(pool.Pending() > 0);
+    CHECK(!calls.back()->Ready());
+    std::atomic<int> callbacks = 0;
+    for (auto&call: calls) {
+        call->Then([&](const HttpPool::Response&response) {
+            if (response.body == "slow") {
+                callbacks++;
+            }
+        });
+    }
+    for (auto&call: calls) {
+        CHECK(call->Get().ok());
+    }
+    //Callbacks run on the worker right after Get is released
+    for (int i = 0; i < 100 && callbacks < 12; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK(callbacks == 12);
+    CHECK(server.maxActive <= 6);
+    CHECK(pool.Pending() == 0);
+
+    //Then on a finished call runs right away
+    bool immediate = false;
+    calls.front()->Then([&](const HttpPool::Response&) { immediate = true; });
+    CHECK(immediate);
+
+    //Downloads stream into the file
+    const auto path = std::filesystem::temp_directory_path() / "mio-http-download.txt";
+    const auto download = pool.Submit({.method = "POST", .url = server.Url("/echo"), .body = "saved",
+                                       .savePath = path.string()})->Get();
+    CHECK(download.ok());
+    CHECK(download.body.empty());
+    std::string saved;
+    std::getline(std::ifstream(path), saved);
+    CHECK(saved == "POST:saved");
+    std::filesystem::remove(path);
+
+    //Timeouts and unreachable hosts complete with an error
+    const auto timeout = pool.Submit({.url = server.Url("/slow"), .timeoutMs = 50})->Get();
+    CHECK(!timeout.ok());
+    CHECK(!timeout.error.empty());
+    const auto refused = pool.Submit({.url = "http://127.0.0.1:1/"})->Get();
+    CHECK(!refused.ok());
+    CHECK(!refused.error.empty());
+    return Check::Result();
+}
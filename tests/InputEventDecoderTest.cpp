@@ -0,0 +1,149 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "InputEventDecoder.h"
+
+using namespace ADBC;
+using Layout = InputEventDecoder::Layout;
+
+namespace {
+    struct Event {
+        int64_t seconds;
+        int64_t micros;
+        uint16_t type;
+        uint16_t code;
+        int32_t value;
+    };
+
+    //A finger going down, moving once and lifting, as a touch screen reports it
+    const std::vector<Event> Touch{
+        {5021, 125000, Input::EV_ABS, Input::ABS_MT_TRACKING_ID, 7},
+        {5021, 125000, Input::EV_ABS, Input::ABS_MT_POSITION_X, 420},
+        {5021, 125000, Input::EV_ABS, Input::ABS_MT_POSITION_Y, 1337},
+        {5021, 125000, Input::EV_KEY, Input::BTN_TOUCH, 1},
+        {5021, 125000, Input::EV_SYN, Input::SYN_REPORT, 0},
+        {5021, 133250, Input::EV_ABS, Input::ABS_MT_POSITION_X, 431},
+        {5021, 133250, Input::EV_SYN, Input::SYN_REPORT, 0},
+        {5021, 141500, Input::EV_ABS, Input::ABS_MT_TRACKING_ID, -1},
+        {5021, 141500, Input::EV_KEY, Input::BTN_TOUCH, 0},
+        {5021, 141500, Input::EV_SYN, Input::SYN_REPORT, 0},
+    };
+
+    template<typename T>
+    void put(std::string&out, T value) {
+        out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    //Records with their timestamps, as read from the device node
+    std::string dump(const std::vector<Event>&events, Layout layout) {
+        std::string out;
+        for (const auto&event: events) {
+            if (layout == Layout::Timeval32) {
+                put(out, static_cast<int32_t>(event.seconds));
+                put(out, static_cast<int32_t>(event.micros));
+            }
+            else {
+                put(out, event.seconds);
+                put(out, event.micros);
+            }
+            put(out, event.type);
+            put(out, event.code);
+            put(out, event.value);
+        }
+        return out;
+    }
+
+    bool matches(const std::vector<InputRecord>&records, const std::vector<Event>&events) {
+        if (records.size() != events.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < records.size(); i++) {
+            const double time = static_cast<double>(events[i].seconds) + static_cast<double>(events[i].micros) / 1e6;
+            if (std::abs(records[i].time - time) > 1e-6 || records[i].type != events[i].type ||
+                records[i].code != events[i].code || records[i].value != events[i].value) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::vector<InputRecord> decodeFile(const std::string&bytes, Layout layout) {
+        const auto path = std::filesystem::temp_directory_path() / "mio-input-dump.bin";
+        std::ofstream(path, std::ios::binary) << bytes;
+        auto records = InputEventDecoder::DecodeDump(path.string(), layout);
+        std::filesystem::remove(path);
+        return records;
+    }
+
+    //Feeds bytes in chunks of the given size
+    std::vector<InputRecord> feed(InputEventDecoder&decoder, const std::string&bytes, size_t chunk) {
+        std::vector<InputRecord> records;
+        size_t counted = 0;
+        for (size_t offset = 0; offset < bytes.size(); offset += chunk) {
+            counted += decoder.Feed(std::string_view(bytes).substr(offset, chunk),
+                                    [&](const InputRecord&record) { records.push_back(record); });
+        }
+        CHECK(counted == records.size());
+        return records;
+    }
+}
+
+int main() {
+    const std::string dump32 = dump(Touch, Layout::Timeval32);
+    const std::string dump64 = dump(Touch, Layout::Timeval64);
+    CHECK(dump32.size() == Touch.size() * 16);
+    CHECK(dump64.size() == Touch.size() * 24);
+
+    //Dumps with the layout given and detected
+    CHECK(matches(decodeFile(dump32, Layout::Timeval32), Touch));
+    CHECK(matches(decodeFile(dump64, Layout::Timeval64), Touch));
+    CHECK(matches(decodeFile(dump32, Layout::Auto), Touch));
+    CHECK(matches(decodeFile(dump64, Layout::Auto), Touch));
+    CHECK(decodeFile("", Layout::Auto).empty());
+    CHECK(InputEventDecoder::DecodeDump("/nonexistent/mio-input-dump.bin").empty());
+
+    //Chunks that split records, down to single bytes
+    for (size_t chunk: {1, 5, 16, 23, 24, 25, 100}) {
+        InputEventDecoder fixed32(Layout::Timeval32);
+        CHECK(matches(feed(fixed32, dump32, chunk), Touch));
+        InputEventDecoder fixed64(Layout::Timeval64);
+        CHECK(matches(feed(fixed64, dump64, chunk), Touch));
+        InputEventDecoder detect32;
+        CHECK(matches(feed(detect32, dump32, chunk), Touch));
+        CHECK(detect32.GetLayout() == Layout::Timeval32);
+        InputEventDecoder detect64;
+        CHECK(matches(feed(detect64, dump64, chunk), Touch));
+        CHECK(detect64.GetLayout() == Layout::Timeval64);
+    }
+
+    //A trailing partial record is held back until the rest arrives
+    InputEventDecoder decoder(Layout::Timeval64);
+    std::vector<InputRecord> records;
+    const auto collect = [&](const InputRecord&record) { records.push_back(record); };
+    CHECK(decoder.Feed(std::string_view(dump64).substr(0, 30), collect) == 1);
+    CHECK(decoder.Feed(std::string_view(dump64).substr(30, 17), collect) == 0);
+    CHECK(decoder.Feed(std::string_view(dump64).substr(47), collect) == Touch.size() - 1);
+    CHECK(matches(records, Touch));
+
+    //Encode writes a record with zero time in either layout, and it decodes back
+    for (Layout layout: {Layout::Timeval32, Layout::Timeval64}) {
+        std::string encoded;
+        InputEventDecoder::Encode(Input::EV_ABS, Input::ABS_MT_POSITION_Y, -5, layout, encoded);
+        InputEventDecoder::Encode(Input::EV_SYN, Input::SYN_REPORT, 0, layout, encoded);
+        CHECK(encoded.size() == 2 * InputEventDecoder::RecordSize(layout));
+        CHECK(encoded.find_first_not_of('\0') == InputEventDecoder::RecordSize(layout) - 8);
+        InputEventDecoder roundTrip(layout);
+        records.clear();
+        CHECK(roundTrip.Feed(encoded, collect) == 2);
+        CHECK(records[0].time == 0);
+        CHECK(records[0].type == Input::EV_ABS);
+        CHECK(records[0].code == Input::ABS_MT_POSITION_Y);
+        CHECK(records[0].value == -5);
+        CHECK(records[1].type == Input::EV_SYN);
+    }
+    return Check::Result();
+}
@@ -0,0 +1,46 @@
+#include <iostream>
+
+#include "Bench.h"
+#include "ScriptFixture.h"
+
+//Cost of calling Update through Script::Invoke against the lookup it replaced, which walked every global and
+//converted its key to a string on each call
+int main(int argc, char** argv) {
+    Bench::Init(argc, argv);
+    auto script = LoadScript("invoke-bench", R"(
+ticks = 0
+
+function Update(dt)
+    ticks = ticks + 1
+end
+
+function Replace()
+    Update = function(dt)
+        ticks = ticks + 1
+    end
+end
+)");
+    if (!script) {
+        std::cerr << "Failed to load the benchmark script" << std::endl;
+        return 1;
+    }
+    sol::protected_function update = script->getFunction("Update");
+    sol::state_view lua(update.lua_state());
+    auto scan = [&lua](const std::string&name, float dt) {
+        for (const auto&pair: lua.globals()) {
+            if (pair.second.is<sol::function>() && pair.first.as<std::string>() == name) {
+                sol::protected_function func = lua[name];
+                func(dt);
+                return;
+            }
+        }
+    };
+    Bench::Measure("globals scan + lookup (before)", 100000, [&] { scan("Update", 0.016f); });
+    Bench::Measure("Script::Invoke, cached handle", 100000, [&] { script->Invoke("Update", 0.016f); });
+    Bench::Measure("Script::Invoke, global reassigned", 100000, [&] {
+        script->Invoke("Replace");
+        script->Invoke("Update", 0.016f);
+    });
+    Bench::Measure("protected_function call", 100000, [&] { update(0.016f); });
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <filesystem>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+#include "Bench.h"
+#include "ScriptFixture.h"
+
+//The same checks written the way scripts had to before the in-memory Mat API (through files) and with it
+int main(int argc, char** argv) {
+    Bench::Init(argc, argv);
+    const auto directory = std::filesystem::temp_directory_path() / "mio-tests" / "mat-bench";
+    std::filesystem::create_directories(directory);
+    cv::Mat frame(720, 1280, CV_8UC3);
+    cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+    cv::imwrite((directory / "frame.png").string(), frame);
+    cv::imwrite((directory / "template.png").string(), frame(cv::Rect(400, 200, 64, 64)));
+
+    auto script = LoadScript("mat-bench", R"(
+local framePath = )" + LuaPath(directory / "frame.png") + R"(
+local templatePath = )" + LuaPath(directory / "template.png") + R"(
+local tmp = )" + LuaPath(directory / "tmp.png") + R"(
+local frame = Mat.load(framePath)
+local template = ImageUtils.Template(templatePath)
+local previous = frame:clone()
+
+function FileFind()
+    frame:save(tmp)
+    return ImageUtils.FindFromStr(tmp, templatePath, 0.8)
+end
+
+function MatFind()
+    return ImageUtils.FindFromMat(frame:roi(320, 120, 320, 240), template, 0.8)
+end
+
+function FileRegion()
+    frame:save(tmp)
+    return Mat.load(tmp).rows
+end
+
+function MatRegion()
+    return frame:roi(320, 120, 320, 240).rows
+end
+
+function Resize()
+    return frame:resize(320, 180).rows
+end
+
+function Gray()
+    return frame:cvtColor(Color.BGR2GRAY).rows
+end
+
+function Threshold()
+    return frame:cvtColor(Color.BGR2GRAY):threshold(128):countNonZero()
+end
+
+function ColorMask()
+    return frame:roi(0, 0, 200, 200):inRange({0, 0, 200}, {80, 80, 255}):countNonZero()
+end
+
+function Mean()
+    local b, g, r = frame:roi(0, 0, 200, 200):mean()
+    return b + g + r
+end
+
+function Diff()
+    return frame:absdiff(previous):countNonZero()
+end
+
+function RegionHash()
+    return frame:hash(320, 120, 320, 240)
+end
+)");
+    if (!script) {
+        std::cerr << "Failed to load the benchmark script" << std::endl;
+        return 1;
+    }
+    Bench::Measure("find, save + FindFromStr", 50, [&] { script->Invoke("FileFind"); });
+    Bench::Measure("find, roi + FindFromMat", 50, [&] { script->Invoke("MatFind"); });
+    Bench::Measure("region, save + load", 50, [&] { script->Invoke("FileRegion"); });
+    Bench::Measure("region, roi", 5000, [&] { script->Invoke("MatRegion"); });
+    Bench::Measure("resize", 1000, [&] { script->Invoke("Resize"); });
+    Bench::Measure("cvtColor", 1000, [&] { script->Invoke("Gray"); });
+    Bench::Measure("threshold + countNonZero", 1000, [&] { script->Invoke("Threshold"); });
+    Bench::Measure("inRange + countNonZero", 1000, [&] { script->Invoke("ColorMask"); });
+    Bench::Measure("mean", 1000, [&] { script->Invoke("Mean"); });
+    Bench::Measure("absdiff + countNonZero", 1000, [&] { script->Invoke("Diff"); });
+    Bench::Measure("region hash", 1000, [&] { script->Invoke("RegionHash"); });
+    return 0;
+}
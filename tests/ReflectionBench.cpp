@@ -0,0 +1,48 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "LoadManager.h"
+
+using namespace ADBC;
+
+//Encode and decode of the same recording through each backend generated from the AndroidEvent field list
+int main(int argc, char** argv) {
+    Bench::Init(argc, argv);
+    std::vector<AndroidEvent> events;
+    float time = 0;
+    for (int swipe = 0; swipe < 200; swipe++) {
+        AndroidEvent event;
+        event.type = "swipe";
+        event.start = time;
+        for (int step = 0; step < 50; step++, time += 0.008f) {
+            event.points.emplace_back(time, Point{200 + step * 9.5f, 1600 - step * 14.25f + swipe});
+        }
+        event.end = time;
+        event.id = "swipe " + std::to_string(swipe);
+        events.push_back(event);
+        time += 0.4f;
+    }
+    const std::string yaml = YAML::Dump(YAML::Node(events));
+    const std::string json = nlohmann::json(events).dump();
+    const std::string binary = Reflection::Binary::Encode(events);
+    std::printf("10000 points: %zu bytes YAML, %zu bytes JSON, %zu bytes binary\n", yaml.size(), json.size(),
+                binary.size());
+
+    Bench::Measure("encode, YAML", 10, [&] { Bench::Keep(YAML::Dump(YAML::Node(events)).size()); });
+    Bench::Measure("encode, JSON", 50, [&] { Bench::Keep(nlohmann::json(events).dump().size()); });
+    Bench::Measure("encode, binary", 500, [&] { Bench::Keep(Reflection::Binary::Encode(events).size()); });
+    Bench::Measure("decode, YAML", 10, [&] {
+        Bench::Keep(YAML::Load(yaml).as<std::vector<AndroidEvent>>().size());
+    });
+    Bench::Measure("decode, JSON", 50, [&] {
+        Bench::Keep(nlohmann::json::parse(json).get<std::vector<AndroidEvent>>().size());
+    });
+    Bench::Measure("decode, binary", 500, [&] {
+        std::vector<AndroidEvent> decoded;
+        Reflection::Binary::Decode(binary, decoded);
+        Bench::Keep(decoded.size());
+    });
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include <cmath>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "LoadManager.h"
+
+using namespace ADBC;
+
+namespace {
+    enum class Mode : int16_t {
+        Once,
+        Loop = -300,
+    };
+
+    struct Task {
+        std::string name;
+        int32_t repeat = 0;
+        int64_t offset = 0;
+        uint32_t flags = 0;
+        bool enabled = false;
+        double weight = 0;
+        std::vector<std::string> tags;
+        std::map<std::string, int> counters;
+        std::shared_ptr<AndroidEvent> trigger;
+        std::string legacy;
+    };
+}
+
+template<>
+struct Reflection::Describe<Task> {
+    static constexpr auto fields = std::make_tuple(
+        field("name", &Task::name),
+        field("repeat", &Task::repeat),
+        field("offset", &Task::offset),
+        field("flags", &Task::flags),
+        field("enabled", &Task::enabled),
+        field("weight", &Task::weight),
+        field("tags", &Task::tags, OmitEmpty),
+        field("counters", &Task::counters, OmitEmpty),
+        field("trigger", &Task::trigger),
+        field("legacy", &Task::legacy, ReadOnly));
+};
+
+namespace {
+    AndroidEvent swipe() {
+        AndroidEvent event;
+        event.type = "swipe";
+        event.points = {{1.0f, {10.5f, 20}}, {1.25f, {30, 40.75f}}, {1.5f, {-1, 1e6f}}};
+        event.start = 1.0f;
+        event.end = 1.5f;
+        event.duration = 0;
+        event.id = "drag";
+        return event;
+    }
+
+    Task task() {
+        Task value;
+        value.name = "daily";
+        value.repeat = -3;
+        value.offset = -(int64_t(1) << 40);
+        value.flags = 0xfffffff0;
+        value.enabled = true;
+        value.weight = 0.1;
+        value.tags = {"a", "", "c"};
+        value.counters = {{"x", 1}, {"y", -2}};
+        value.trigger = std::make_shared<AndroidEvent>(swipe());
+        value.legacy = "old";
+        return value;
+    }
+
+    bool same(const AndroidEvent&a, const AndroidEvent&b) {
+        return a.type == b.type && a.points == b.points && a.start == b.start && a.end == b.end && a.id == b.id &&
+               a.tracks == b.tracks;
+    }
+
+    bool same(const Task&a, const Task&b) {
+        return a.name == b.name && a.repeat == b.repeat && a.offset == b.offset && a.flags == b.flags &&
+               a.enabled == b.enabled && a.weight == b.weight && a.tags == b.tags &&
+               a.counters == b.counters && !a.trigger == !b.trigger && (!a.trigger || same(*a.trigger, *b.trigger));
+    }
+}
+
+int main() {
+    const AndroidEvent event = swipe();
+    const Task original = task();
+
+    //YAML
+    const auto yamlEvent = YAML::Load(YAML::Dump(YAML::Node(event))).as<AndroidEvent>();
+    CHECK(same(yamlEvent, event));
+    CHECK_NEAR(yamlEvent.duration, 0.5f, 1e-6f);
+    CHECK(!YAML::Node(event)["tracks"].IsDefined());
+    const auto yamlTask = YAML::Load(YAML::Dump(YAML::Node(original))).as<Task>();
+    CHECK(same(yamlTask, original));
+    CHECK(!YAML::Node(original)["legacy"].IsDefined());
+    CHECK(YAML::Load("{name: old, legacy: kept}").as<Task>().legacy == "kept");
+    CHECK(!YAML::Node(Task{})["tags"].IsDefined());
+
+    //JSON
+    const auto jsonEvent = nlohmann::json::parse(nlohmann::json(event).dump()).get<AndroidEvent>();
+    CHECK(same(jsonEvent, event));
+    CHECK_NEAR(jsonEvent.duration, 0.5f, 1e-6f);
+    CHECK(nlohmann::json(event)["duration"].get<float>() == 0.5f);
+    const auto jsonTask = nlohmann::json::parse(nlohmann::json(original).dump()).get<Task>();
+    CHECK(same(jsonTask, original));
+    CHECK(!nlohmann::json(original).contains("legacy"));
+    CHECK(nlohmann::json::parse(R"({"name": "old", "legacy": "kept"})").get<Task>().legacy == "kept");
+    CHECK(nlohmann::json(Task{})["trigger"].is_null());
+
+    //Binary, exact for floats, with containers of reflected types
+    AndroidEvent binaryEvent;
+    CHECK(Reflection::Binary::Decode(Reflection::Binary::Encode(event), binaryEvent));
+    CHECK(same(binaryEvent, event));
+    CHECK_NEAR(binaryEvent.duration, 0.5f, 1e-6f);
+    //The derived duration is not stored, decoding recomputes it
+    AndroidEvent withDuration = event;
+    withDuration.duration = 123;
+    CHECK(Reflection::Binary::Encode(withDuration) == Reflection::Binary::Encode(event));
+    Task binaryTask;
+    const std::string encoded = Reflection::Binary::Encode(original);
+    CHECK(Reflection::Binary::Decode(encoded, binaryTask));
+    CHECK(same(binaryTask, original));
+    CHECK(binaryTask.legacy.empty());
+    std::map<std::string, std::vector<AndroidEvent>> replays{{"a", {event, event}}, {"b", {}}};
+    decltype(replays) binaryReplays;
+    CHECK(Reflection::Binary::Decode(Reflection::Binary::Encode(replays), binaryReplays));
+    CHECK(binaryReplays.size() == 2 && binaryReplays["a"].size() == 2 && same(binaryReplays["a"][1], event));
+
+    std::vector<Mode> modes{Mode::Once, Mode::Loop}, binaryModes;
+    CHECK(Reflection::Binary::Decode(Reflection::Binary::Encode(modes), binaryModes) && binaryModes == modes);
+
+    //Truncated, trailing and oversized binary data is rejected
+    for (size_t size = 0; size < encoded.size(); size++) {
+        Task truncated;
+        CHECK(!Reflection::Binary::Decode(std::string_view(encoded).substr(0, size), truncated));
+    }
+    CHECK(!Reflection::Binary::Decode(encoded + '\0', binaryTask));
+    std::vector<int> huge;
+    CHECK(!Reflection::Binary::Decode("\xff\xff\xff\xff\x0f", huge));
+    std::string unterminated(11, '\xff');
+    uint64_t wide;
+    CHECK(!Reflection::Binary::Decode(unterminated, wide));
+
+    //The binary encoding only for an explicit .bin, YAML for anything unknown
+    CHECK(LoadManager::FormatOf("replays.bin") == LoadManager::Format::Binary);
+    CHECK(LoadManager::FormatOf("events.json") == LoadManager::Format::Json);
+    CHECK(LoadManager::FormatOf("events.yml") == LoadManager::Format::Yaml);
+    CHECK(LoadManager::FormatOf("events.yaml") == LoadManager::Format::Yaml);
+    CHECK(LoadManager::FormatOf("events.txt") == LoadManager::Format::Yaml);
+    CHECK(LoadManager::FormatOf("events") == LoadManager::Format::Yaml);
+    return Check::Result();
+}
@@ -0,0 +1,186 @@
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "ReplayJournal.h"
+#include "ReplayRepository.h"
+
+using namespace ADBC;
+
+namespace {
+    const auto Directory = std::filesystem::temp_directory_path() / "mio-tests" / "replay-journal";
+
+    ReplayJournal::Entry put(const std::string&name, const std::string&blob) {
+        return {ReplayJournal::Op::Put, "device", name, "", blob};
+    }
+
+    std::vector<std::string> names(const std::vector<ReplayJournal::Entry>&entries) {
+        std::vector<std::string> result;
+        for (const auto&entry: entries) {
+            result.push_back(entry.name);
+        }
+        return result;
+    }
+
+    std::string read(const std::filesystem::path&path) {
+        std::ifstream in(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    }
+
+    void write(const std::filesystem::path&path, const std::string&data) {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << data;
+    }
+
+    std::vector<AndroidEvent> replay(float x) {
+        AndroidEvent tap;
+        tap.type = "tap";
+        tap.points = {{0.5f, {x, 800}}};
+        tap.start = tap.end = 0.5f;
+        return {tap};
+    }
+
+    std::vector<std::string> listed(const ReplayRepository&replays) {
+        std::vector<std::string> result;
+        for (const auto&info: replays.List("device")) {
+            result.push_back(info.name);
+        }
+        return result;
+    }
+}
+
+int main() {
+    std::filesystem::remove_all(Directory);
+    std::filesystem::create_directories(Directory);
+    const auto path = Directory / "journal";
+
+    //Records survive reopening in order
+    {
+        ReplayJournal journal(path.string());
+        CHECK(journal.Recover().empty());
+        CHECK(journal.Append(put("a", "1")));
+        CHECK(journal.Append(put("b", "22")));
+        CHECK(journal.Append({ReplayJournal::Op::Rename, "device", "a", "c", "1"}));
+    }
+    const std::string intact = read(path);
+    {
+        ReplayJournal journal(path.string());
+        const auto entries = journal.Recover();
+        CHECK((names(entries) == std::vector<std::string>{"a", "b", "a"}));
+        CHECK(entries[2].op == ReplayJournal::Op::Rename && entries[2].target == "c");
+        CHECK(entries[1].blob == "22");
+        CHECK(journal.Size() == intact.size());
+    }
+
+    //A torn tail is cut back to the last complete record and appending continues after it
+    write(path, intact.substr(0, intact.size() - 3));
+    {
+        ReplayJournal journal(path.string());
+        CHECK((names(journal.Recover()) == std::vector<std::string>{"a", "b"}));
+        CHECK(journal.Records() == 2);
+        CHECK(std::filesystem::file_size(path) == journal.Size());
+        CHECK(journal.Append(put("d", "4")));
+    }
+    {
+        ReplayJournal journal(path.string());
+        CHECK((names(journal.Recover()) == std::vector<std::string>{"a", "b", "d"}));
+    }
+
+    //A record failing its CRC is skipped when an intact one follows, the last one is cut like a torn tail
+    std::string damaged = intact;
+    const size_t second = intact.find("b", 8);
+    damaged[second] = 'x';
+    write(path, damaged);
+    {
+        ReplayJournal journal(path.string());
+        CHECK((names(journal.Recover()) == std::vector<std::string>{"a", "a"}));
+        CHECK(journal.Records() == 3);
+        CHECK(journal.Size() == intact.size());
+    }
+    damaged = intact;
+    damaged.back() ^= 0x55;
+    write(path, damaged);
+    {
+        ReplayJournal journal(path.string());
+        CHECK((names(journal.Recover()) == std::vector<std::string>{"a", "b"}));
+        CHECK(std::filesystem::file_size(path) == journal.Size());
+    }
+
+    //Drop keeps the records appended after the snapshot took its offset
+    std::filesystem::remove(path);
+    {
+        ReplayJournal journal(path.string());
+        journal.Recover();
+        CHECK(journal.Append(put("a", "1")));
+        CHECK(journal.Append(put("b", "2")));
+        const uint64_t offset = journal.Size();
+        const size_t count = journal.Records();
+        CHECK(journal.Append(put("c", "3")));
+        CHECK(journal.Drop(offset, count));
+        CHECK(journal.Records() == 1);
+        CHECK(journal.Append(put("d", "4")));
+    }
+    {
+        ReplayJournal journal(path.string());
+        CHECK((names(journal.Recover()) == std::vector<std::string>{"c", "d"}));
+    }
+
+    //Nothing touches a journal that was not recovered
+    const std::string before = read(path);
+    {
+        ReplayJournal journal(path.string());
+        CHECK(!journal.Append(put("e", "5")));
+        CHECK(!journal.Reset());
+        CHECK(!journal.Drop(0, 0));
+    }
+    CHECK(read(path) == before);
+
+    //Put, Rename and Remove come back from the journal alone when the library is reopened without a save
+    const auto library = Directory / "replays.bin";
+    const auto libraryJournal = Directory / "replays.bin.journal";
+    {
+        ReplayRepository replays(library.string());
+        CHECK(replays.Open());
+        CHECK(replays.Put("device", "a", replay(100)));
+        CHECK(replays.Put("device", "b", replay(200)));
+        CHECK(replays.Rename("device", "a", "c"));
+        CHECK(replays.Remove("device", "b"));
+    }
+    CHECK(!std::filesystem::exists(library));
+    {
+        ReplayRepository replays(library.string());
+        CHECK(replays.Open());
+        CHECK((listed(replays) == std::vector<std::string>{"c"}));
+        const auto events = replays.Get("device", "c");
+        CHECK(events && events->size() == 1 && events->front().points[0].second.x == 100);
+        CHECK(replays.Save());
+        CHECK(std::filesystem::file_size(libraryJournal) == 0);
+    }
+    {
+        ReplayRepository replays(library.string());
+        CHECK(replays.Open());
+        CHECK((listed(replays) == std::vector<std::string>{"c"}));
+        CHECK(replays.Put("device", "d", replay(300)));
+    }
+
+    //A library that cannot be read stays as it is: changes and saves fail and the journal is neither applied away
+    //nor emptied
+    write(library, "not a replay store");
+    const std::string pending = read(libraryJournal);
+    CHECK(!pending.empty());
+    {
+        ReplayRepository replays(library.string());
+        CHECK(!replays.Open());
+        CHECK(!replays.Put("device", "e", replay(400)));
+        CHECK(!replays.Remove("device", "c"));
+        CHECK(!replays.Rename("device", "c", "f"));
+        CHECK(!replays.Save());
+    }
+    CHECK(read(library) == "not a replay store");
+    CHECK(read(libraryJournal) == pending);
+
+    std::filesystem::remove_all(Directory);
+    return Check::Result();
+}
@@ -0,0 +1,59 @@
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "LoadManager.h"
+#include "ReplayStore.h"
+
+using namespace ADBC;
+
+//Saving and loading a library of recordings as the YAML events.yml through LoadManager and as a replay store
+int main(int argc, char** argv) {
+    Bench::Init(argc, argv);
+    const auto directory = std::filesystem::temp_directory_path() / "mio-tests" / "replay-store-bench";
+    std::filesystem::create_directories(directory);
+    ReplayStore::Library library;
+    for (int replay = 0; replay < 10; replay++) {
+        std::vector<AndroidEvent> events;
+        float time = 0;
+        for (int swipe = 0; swipe < 50; swipe++) {
+            AndroidEvent event;
+            event.type = "swipe";
+            event.start = time;
+            for (int step = 0; step < 60; step++, time += 0.008f) {
+                event.points.emplace_back(time, Point{200 + step * 9.5f + replay, 1600 - step * 14.25f + swipe});
+            }
+            event.end = time;
+            events.push_back(event);
+            time += 0.4f;
+        }
+        library["emulator-5554"]["replay " + std::to_string(replay)] = events;
+    }
+    const std::string yaml = (directory / "events.yml").string();
+    const std::string store = (directory / "events.bin").string();
+    LoadManager::Save(library, yaml);
+    ReplayStore::Save(library, store);
+    std::printf("30000 points: %ju bytes as YAML, %ju bytes as a store\n",
+                static_cast<uintmax_t>(std::filesystem::file_size(yaml)),
+                static_cast<uintmax_t>(std::filesystem::file_size(store)));
+
+    Bench::Measure("save, LoadManager YAML", 10, [&] { LoadManager::Save(library, yaml); });
+    Bench::Measure("save, ReplayStore", 10, [&] { ReplayStore::Save(library, store); });
+    Bench::Measure("load all, LoadManager YAML", 10, [&] {
+        Bench::Keep(LoadManager::Load<ReplayStore::Library>(yaml).size());
+    });
+    Bench::Measure("load all, ReplayStore", 10, [&] {
+        ReplayStore replays;
+        replays.Open(store);
+        Bench::Keep(replays.LoadAll().size());
+    });
+    Bench::Measure("open and load one, ReplayStore", 100, [&] {
+        ReplayStore replays;
+        replays.Open(store);
+        Bench::Keep(replays.Load(*replays.Find("emulator-5554", "replay 7"))->size());
+    });
+    std::filesystem::remove_all(directory);
+    return 0;
+}
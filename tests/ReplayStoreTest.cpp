@@ -0,0 +1,174 @@
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "LoadManager.h"
+#include "ReplayStore.h"
+
+using namespace ADBC;
+
+namespace {
+    const auto Directory = std::filesystem::temp_directory_path() / "mio-tests" / "replay-store";
+
+    std::vector<AndroidEvent> replay(size_t swipes) {
+        std::vector<AndroidEvent> events;
+        AndroidEvent tap;
+        tap.type = "tap";
+        tap.points = {{0.25f, {540.125f, 1200.5f}}};
+        tap.start = tap.end = 0.25f;
+        tap.id = "confirm";
+        events.push_back(tap);
+        float time = 1;
+        for (size_t i = 0; i < swipes; i++) {
+            AndroidEvent swipe;
+            swipe.type = "swipe";
+            swipe.start = time;
+            for (int step = 0; step < 40; step++, time += 0.008f) {
+                swipe.points.emplace_back(time, Point{100 + step * 12.375f, 1800 - step * step * 0.5f});
+            }
+            swipe.end = time;
+            events.push_back(swipe);
+            time += 0.5f;
+        }
+        AndroidEvent multi;
+        multi.type = "multi";
+        multi.start = time;
+        multi.end = time + 0.2f;
+        multi.tracks = {
+            {{time, {300, 900}}, {time + 0.2f, {200, 800}}},
+            {{time, {700, 900}}, {time + 0.2f, {800, 1000}}},
+        };
+        multi.points = multi.tracks.front();
+        events.push_back(multi);
+        AndroidEvent custom;
+        custom.type = "key:back";
+        custom.start = custom.end = time + 1;
+        events.push_back(custom);
+        return events;
+    }
+
+    //Times are stored to the microsecond, coordinates to 1/8 pixel
+    bool samePoints(const std::vector<std::pair<float, Point>>&a, const std::vector<std::pair<float, Point>>&b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); i++) {
+            if (std::abs(a[i].first - b[i].first) > 2e-5f || std::abs(a[i].second.x - b[i].second.x) > 0.0625f ||
+                std::abs(a[i].second.y - b[i].second.y) > 0.0625f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool same(const std::vector<AndroidEvent>&a, const std::vector<AndroidEvent>&b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); i++) {
+            if (a[i].type != b[i].type || a[i].id != b[i].id || std::abs(a[i].start - b[i].start) > 2e-5f ||
+                std::abs(a[i].end - b[i].end) > 2e-5f || !samePoints(a[i].points, b[i].points) ||
+                a[i].tracks.size() != b[i].tracks.size()) {
+                return false;
+            }
+            for (size_t t = 0; t < a[i].tracks.size(); t++) {
+                if (!samePoints(a[i].tracks[t], b[i].tracks[t])) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
+
+int main() {
+    std::filesystem::remove_all(Directory);
+    std::filesystem::create_directories(Directory);
+    const auto events = replay(20);
+
+    //Encode and Decode
+    const std::string blob = ReplayStore::Encode(events);
+    std::vector<AndroidEvent> decoded;
+    CHECK(ReplayStore::Decode(blob, decoded));
+    CHECK(same(events, decoded));
+    CHECK_NEAR(decoded[1].duration, decoded[1].end - decoded[1].start, 1e-6f);
+    CHECK(ReplayStore::Decode(ReplayStore::Encode({}), decoded));
+    CHECK(decoded.empty());
+    CHECK(blob.size() < YAML::Dump(YAML::Node(events)).size() / 4);
+
+    //Corrupt blobs are rejected rather than thrown on or read past
+    for (size_t size = 0; size < blob.size(); size++) {
+        CHECK(!ReplayStore::Decode(std::string_view(blob).substr(0, size), decoded));
+    }
+    uint32_t seed = 1;
+    for (int round = 0; round < 2000; round++) {
+        std::string broken = blob;
+        for (int flip = 0; flip < 4; flip++) {
+            seed = seed * 1664525 + 1013904223;
+            broken[seed % broken.size()] = static_cast<char>(seed >> 24);
+        }
+        ReplayStore::Decode(broken, decoded);
+    }
+    CHECK(!ReplayStore::Decode("\xff\xff\xff\xff\xff\xff\xff\xff\xff\x01", decoded));
+
+    //Save, Open, Find and Load
+    ReplayStore::Library library;
+    library["emulator-5554"]["daily"] = events;
+    library["emulator-5554"]["empty"] = {};
+    library["R58M"]["daily"] = replay(3);
+    const std::string path = (Directory / "events.bin").string();
+    CHECK(ReplayStore::Save(library, path));
+    CHECK(!std::filesystem::exists(path + ".tmp"));
+    ReplayStore store;
+    CHECK(!store.IsOpen());
+    CHECK(store.Open(path));
+    CHECK(store.IsOpen());
+    CHECK(store.Index().size() == 3);
+    const auto* entry = store.Find("emulator-5554", "daily");
+    CHECK(entry != nullptr);
+    if (entry != nullptr) {
+        CHECK(entry->events == events.size());
+        CHECK_NEAR(entry->duration, ReplayStore::Duration(events), 1e-5f);
+        CHECK(store.Raw(*entry) == blob);
+        const auto loaded = store.Load(*entry);
+        CHECK(loaded && same(*loaded, events));
+    }
+    CHECK(store.Find("R58M", "missing") == nullptr);
+    CHECK(store.Find("unknown", "daily") == nullptr);
+    const auto all = store.LoadAll();
+    CHECK(all.size() == 2);
+    CHECK(all.at("emulator-5554").at("empty").empty());
+    CHECK(same(all.at("R58M").at("daily"), library["R58M"]["daily"]));
+    store.Close();
+    CHECK(!store.IsOpen());
+
+    //Files that are not stores
+    CHECK(!store.Open((Directory / "missing.bin").string()));
+    std::ofstream((Directory / "garbage.bin").string(), std::ios::binary) << "not a replay store at all";
+    CHECK(!store.Open((Directory / "garbage.bin").string()));
+    std::ofstream((Directory / "truncated.bin").string(), std::ios::binary)
+            << std::ifstream(path, std::ios::binary).rdbuf();
+    std::filesystem::resize_file(Directory / "truncated.bin", std::filesystem::file_size(path) - 3);
+    CHECK(!store.Open((Directory / "truncated.bin").string()));
+
+    //YAML import and export
+    const std::string yaml = (Directory / "events.yml").string();
+    CHECK(LoadManager::Save(library, yaml));
+    const std::string imported = (Directory / "imported.bin").string();
+    CHECK(ReplayStore::ImportYaml(yaml, imported));
+    CHECK(store.Open(imported));
+    CHECK(store.Index().size() == 3);
+    CHECK(same(store.LoadAll().at("emulator-5554").at("daily"), events));
+    store.Close();
+    const std::string exported = (Directory / "exported.yml").string();
+    CHECK(ReplayStore::ExportYaml(imported, exported));
+    const auto roundTrip = LoadManager::Load<ReplayStore::Library>(exported);
+    CHECK(same(roundTrip.at("R58M").at("daily"), library["R58M"]["daily"]));
+    CHECK(!ReplayStore::ImportYaml((Directory / "missing.yml").string(), imported));
+
+    std::filesystem::remove_all(Directory);
+    return Check::Result();
+}
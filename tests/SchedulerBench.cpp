@@ -0,0 +1,73 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "Bench.h"
+#include "Scheduler.h"
+#include "ScriptFixture.h"
+
+//How many simulated devices the scheduler keeps at their tick rate. Every device runs its own script instance whose
+//Update waits on a Sleep the way a real one waits on adb, at 10 Hz with 50 ms of waiting per tick. A device counts as
+//driven while it reaches 90% of the ticks it is due.
+namespace {
+    constexpr float Rate = 10;
+
+    const char* Source = R"(
+function Update(dt)
+    Sleep(50)
+end
+)";
+
+    //Fraction of the due ticks the slowest device managed
+    double run(size_t devices, std::chrono::milliseconds duration) {
+        std::vector<std::shared_ptr<Script>> scripts;
+        for (size_t i = 0; i < devices; i++) {
+            auto script = LoadScript("scheduler-bench", Source);
+            if (!script) {
+                return 0;
+            }
+            scripts.push_back(std::move(script));
+        }
+        std::vector<std::shared_ptr<TickStats>> stats;
+        std::atomic<bool> running = true;
+        double worst = 1;
+        {
+            Scheduler scheduler;
+            for (auto&script: scripts) {
+                stats.push_back(std::make_shared<TickStats>());
+                scheduler.Spawn(script, nullptr, FixedRate(Rate), [&running] { return running.load(); }, nullptr,
+                                stats.back());
+            }
+            std::this_thread::sleep_for(duration);
+            running = false;
+            const double due = std::chrono::duration<double>(duration).count() * Rate;
+            for (const auto&it: stats) {
+                worst = std::min(worst, static_cast<double>(it->GetSnapshot().ticks) / due);
+            }
+        }
+        return worst;
+    }
+}
+
+int main(int argc, char** argv) {
+    Bench::Init(argc, argv);
+    const std::vector<size_t> counts = Bench::quick
+                                           ? std::vector<size_t>{10}
+                                           : std::vector<size_t>{10, 50, 100, 200, 400, 800};
+    const auto duration = std::chrono::milliseconds(Bench::quick ? 500 : 5000);
+    std::printf("%zu hardware threads, %.0f Hz, 50 ms blocked per tick\n",
+                static_cast<size_t>(std::thread::hardware_concurrency()), Rate);
+    size_t driven = 0;
+    for (size_t devices: counts) {
+        const double reached = run(devices, duration);
+        std::printf("%6zu devices: slowest reached %5.1f%% of its ticks\n", devices, reached * 100);
+        if (reached < 0.9) {
+            break;
+        }
+        driven = devices;
+    }
+    std::printf("driven at full rate: %zu devices\n", driven);
+    return 0;
+}
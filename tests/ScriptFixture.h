@@ -0,0 +1,28 @@
+#ifndef SCRIPTFIXTURE_H
+#define SCRIPTFIXTURE_H
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "Script.h"
+
+//Writes source as main.lua of its own scripts directory under the temp directory and loads it, nullptr on failure
+inline std::shared_ptr<Script> LoadScript(const std::string&name, const std::string&source) {
+    const auto directory = std::filesystem::temp_directory_path() / "mio-tests" / name;
+    std::filesystem::create_directories(directory);
+    std::ofstream(directory / "main.lua") << source;
+    auto script = std::make_shared<Script>();
+    if (!script->Initialize(directory.string())) {
+        return nullptr;
+    }
+    return script;
+}
+
+//Absolute path inside the temp directory, quoted as a Lua string literal
+inline std::string LuaPath(const std::filesystem::path&path) {
+    return "[[" + path.generic_string() + "]]";
+}
+
+
+#endif //SCRIPTFIXTURE_H
@@ -0,0 +1,104 @@
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <thread>
+
+#include "Check.h"
+#include "Scheduler.h"
+#include "ScriptManager.h"
+
+//One script on 16 simulated devices at once: every device gets its own instance from ScriptManager::Acquire, all of
+//them tick concurrently on one scheduler, and none sees another's globals
+namespace {
+    constexpr size_t Devices = 16;
+
+    const char* Source = R"(
+ticks = 0
+destroyed = false
+
+function Update(dt)
+    ticks = ticks + 1
+    local scratch = {}
+    for i = 1, 200 do
+        scratch[i] = i * dt
+    end
+end
+
+function OnDestroy()
+    destroyed = true
+end
+
+function Ticks()
+    return ticks
+end
+
+function Destroyed()
+    return destroyed
+end
+
+function SetMarker(value)
+    marker = value
+end
+
+function Marker()
+    return marker
+end
+)";
+}
+
+int main() {
+    const std::string root = RC::Utils::File::PlatformPath(std::string(RESOURCING("scripts")));
+    const std::string name = "mio-instances-test";
+    const auto directory = std::filesystem::path(root) / name;
+    std::filesystem::create_directories(directory);
+    std::ofstream(directory / "main.lua") << Source;
+
+    ScriptManager manager;
+    manager.Add(RC::Utils::File::PlatformPath(root + "/" + name));
+    manager.Initialize();
+    std::vector<std::shared_ptr<Script>> instances;
+    for (size_t i = 0; i < Devices; i++) {
+        instances.push_back(manager.Acquire(name, "device-" + std::to_string(i)));
+        CHECK(instances.back() != nullptr);
+    }
+    if (Check::failures > 0) {
+        return Check::Result();
+    }
+    CHECK(std::set<std::shared_ptr<Script>>(instances.begin(), instances.end()).size() == Devices);
+    CHECK(manager.Acquire(name, "device-0") == instances[0]);
+    CHECK(manager.GetScript(name) != instances[0]);
+
+    std::vector<std::shared_ptr<TickStats>> stats;
+    {
+        std::atomic<bool> running = true;
+        Scheduler scheduler(4);
+        for (auto&instance: instances) {
+            stats.push_back(std::make_shared<TickStats>());
+            scheduler.Spawn(instance, nullptr, FixedRate(60), [&running] { return running.load(); }, nullptr,
+                            stats.back());
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        running = false;
+    }
+
+    for (size_t i = 0; i < Devices; i++) {
+        const auto ticks = instances[i]->Invoke("Ticks").as<int>();
+        //Lost or doubled updates would show up as a mismatch with the scheduler's own count
+        CHECK(ticks > 0);
+        CHECK(static_cast<uint64_t>(ticks) == stats[i]->GetSnapshot().ticks);
+        CHECK(instances[i]->Invoke("Destroyed").as<bool>());
+        instances[i]->Invoke("SetMarker", static_cast<int>(i));
+    }
+    for (size_t i = 0; i < Devices; i++) {
+        CHECK(instances[i]->Invoke("Marker").as<int>() == static_cast<int>(i));
+    }
+    for (size_t i = 0; i < Devices; i++) {
+        manager.Release(name, "device-" + std::to_string(i), instances[i]);
+    }
+    CHECK(manager.Acquire(name, "device-0") != instances[0]);
+
+    std::error_code ec;
+    std::filesystem::remove_all(directory, ec);
+    return Check::Result();
+}
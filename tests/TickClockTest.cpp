@@ -0,0 +1,87 @@
+#include <cmath>
+#include <limits>
+
+#include "Check.h"
+#include "TickClock.h"
+
+using namespace std::chrono_literals;
+using Clock = TickClock::Clock;
+
+//Ticks driven by hand-made time points, 100 Hz so that the grid is 10 ms
+int main() {
+    const Clock::time_point t0 = Clock::now();
+
+    //On time: the next deadline is one interval after the previous one, however long the tick took
+    TickClock clock(FixedRate(100));
+    clock.Reset(t0);
+    CHECK_NEAR(clock.Begin(t0), 0.01f, 1e-6f);
+    CHECK(clock.End(t0 + 2ms) == t0 + 10ms);
+    CHECK_NEAR(clock.Begin(t0 + 10ms), 0.01f, 1e-6f);
+    CHECK(clock.End(t0 + 17ms) == t0 + 20ms);
+
+    //Skip drops the missed ticks and stays on the grid
+    TickStats skipStats;
+    TickClock skip(FixedRate(100, FixedRate::Overrun::Skip));
+    skip.Reset(t0);
+    skip.Begin(t0);
+    CHECK(skip.End(t0 + 35ms, &skipStats) == t0 + 40ms);
+    auto snapshot = skipStats.GetSnapshot();
+    CHECK(snapshot.ticks == 1);
+    CHECK(snapshot.overruns == 1);
+    CHECK(snapshot.skipped == 3);
+
+    //CatchUp runs the missed ticks back to back, deadlines already passed are returned as they are
+    TickStats catchUpStats;
+    TickClock catchUp(FixedRate(100, FixedRate::Overrun::CatchUp));
+    catchUp.Reset(t0);
+    catchUp.Begin(t0);
+    CHECK(catchUp.End(t0 + 35ms, &catchUpStats) == t0 + 10ms);
+    catchUp.Begin(t0 + 35ms);
+    CHECK(catchUp.End(t0 + 36ms, &catchUpStats) == t0 + 20ms);
+    catchUp.Begin(t0 + 36ms);
+    CHECK(catchUp.End(t0 + 37ms, &catchUpStats) == t0 + 30ms);
+    catchUp.Begin(t0 + 37ms);
+    CHECK(catchUp.End(t0 + 38ms, &catchUpStats) == t0 + 40ms);
+    CHECK(catchUpStats.GetSnapshot().skipped == 0);
+    //More than maxCatchUp intervals behind it gives up and resynchronizes on the end of the tick
+    catchUp.Begin(t0 + 40ms);
+    CHECK(catchUp.End(t0 + 150ms, &catchUpStats) == t0 + 150ms);
+    CHECK(catchUpStats.GetSnapshot().skipped == 10);
+
+    //Stretch restarts the grid from the end of the late tick
+    TickStats stretchStats;
+    TickClock stretch(FixedRate(100, FixedRate::Overrun::Stretch));
+    stretch.Reset(t0);
+    stretch.Begin(t0);
+    CHECK(stretch.End(t0 + 35ms, &stretchStats) == t0 + 45ms);
+    stretch.Begin(t0 + 45ms);
+    CHECK(stretch.End(t0 + 47ms, &stretchStats) == t0 + 55ms);
+    CHECK(stretchStats.GetSnapshot().overruns == 1);
+    CHECK(stretchStats.GetSnapshot().skipped == 0);
+
+    //Durations land in power-of-two buckets: 35 ms below 65536us, 2 ms below 2048us
+    snapshot = stretchStats.GetSnapshot();
+    CHECK(snapshot.histogram[10] == 1);
+    CHECK(snapshot.histogram[5] == 1);
+    CHECK(snapshot.maxMicroseconds == 35000);
+    CHECK_NEAR(snapshot.meanMicroseconds, 18500.0, 1e-9);
+    CHECK(TickStats::BucketLabel(0) == "<64us");
+    CHECK(TickStats::BucketLabel(10) == "<65536us");
+    CHECK(TickStats::BucketLabel(TickStats::Buckets - 1) == ">=1048576us");
+    CHECK(TickStats::HistogramText(snapshot) == "<2048us:1 <65536us:1");
+    CHECK(TickStats::HistogramText(TickStats().GetSnapshot()).empty());
+
+    //Rates out of range are clamped, unusable ones fall back to the default
+    CHECK(FixedRate(0).frequency == FixedRate::DefaultFrequency);
+    CHECK(FixedRate(-30).frequency == FixedRate::DefaultFrequency);
+    CHECK(FixedRate(std::numeric_limits<float>::quiet_NaN()).frequency == FixedRate::DefaultFrequency);
+    CHECK(FixedRate(1e9f).frequency == FixedRate::MaxFrequency);
+    CHECK(FixedRate(1e9f).interval == 1000us);
+    CHECK(FixedRate(0.001f).frequency == FixedRate::MinFrequency);
+    FixedRate rate(60);
+    rate.SetFrequency(0);
+    CHECK(rate.interval > 0us);
+    rate.SetFrequency(50);
+    CHECK(rate.interval == 20000us);
+    return Check::Result();
+}
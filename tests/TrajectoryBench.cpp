@@ -0,0 +1,27 @@
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "Bench.h"
+#include "Trajectory.h"
+
+using namespace ADBC;
+
+//A long, wavy swipe as recorded at 250 Hz, simplified at the tolerance replays use and resampled back up
+int main(int argc, char** argv) {
+    Bench::Init(argc, argv);
+    std::vector<Trajectory::Sample> swipe;
+    for (int i = 0; i < 5000; i++) {
+        const float t = i * 0.004f;
+        swipe.emplace_back(t, Point{540 + 400 * std::sin(t * 0.7f), 1800 - 60 * t + 25 * std::sin(t * 9)});
+    }
+    const auto kept = Trajectory::SimplifyTimed(swipe, 2);
+    std::printf("%zu samples, %zu kept at 2 px, deviation %.3f px\n", swipe.size(), kept.size(),
+                Trajectory::Deviation(swipe, kept));
+    Bench::Measure("Simplify, 2 px", 200, [&] { Bench::Keep(Trajectory::Simplify(swipe, 2).size()); });
+    Bench::Measure("SimplifyTimed, 2 px", 200, [&] { Bench::Keep(Trajectory::SimplifyTimed(swipe, 2).size()); });
+    Bench::Measure("SimplifyTimed, 0.5 px", 200, [&] { Bench::Keep(Trajectory::SimplifyTimed(swipe, 0.5f).size()); });
+    Bench::Measure("Resample, 8 px", 200, [&] { Bench::Keep(Trajectory::Resample(kept, 8).size()); });
+    Bench::Measure("Deviation", 200, [&] { Bench::Keep(static_cast<size_t>(Trajectory::Deviation(swipe, kept))); });
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <cmath>
+#include <vector>
+
+#include "Check.h"
+#include "Trajectory.h"
+
+using namespace ADBC;
+using Sample = Trajectory::Sample;
+
+namespace {
+    //Quarter circle of radius 400 around (500, 1000), sampled every 4 ms at constant speed
+    std::vector<Sample> arc(size_t count) {
+        std::vector<Sample> samples;
+        for (size_t i = 0; i < count; i++) {
+            const float angle = static_cast<float>(i) / static_cast<float>(count - 1) * 1.5707964f;
+            samples.emplace_back(i * 0.004f, Point{500 + 400 * std::cos(angle), 1000 - 400 * std::sin(angle)});
+        }
+        return samples;
+    }
+
+    //Straight swipe that stops halfway for 300 ms and then continues at twice the speed
+    std::vector<Sample> paused() {
+        std::vector<Sample> samples;
+        float time = 0;
+        for (int i = 0; i <= 50; i++, time += 0.004f) {
+            samples.emplace_back(time, Point{100 + i * 4.0f, 500});
+        }
+        for (int i = 0; i < 75; i++, time += 0.004f) {
+            samples.emplace_back(time, Point{300, 500});
+        }
+        for (int i = 1; i <= 25; i++, time += 0.004f) {
+            samples.emplace_back(time, Point{300 + i * 8.0f, 500});
+        }
+        return samples;
+    }
+
+    bool sameEnds(const std::vector<Sample>&a, const std::vector<Sample>&b) {
+        return a.front().first == b.front().first && a.front().second == b.front().second &&
+               a.back().first == b.back().first && a.back().second == b.back().second;
+    }
+}
+
+int main() {
+    //Helpers
+    CHECK_NEAR(Trajectory::Distance({0, 0}, {3, 4}), 5.0f, 1e-5f);
+    CHECK_NEAR(Trajectory::DistanceToLine({0, 0}, {10, 0}, {5, 3}), 3.0f, 1e-5f);
+    CHECK_NEAR(Trajectory::DistanceToLine({1, 1}, {1, 1}, {4, 5}), 5.0f, 1e-5f);
+    const Point middle = Trajectory::Interpolate({1.0f, {0, 0}}, {2.0f, {10, 20}}, 1.5f);
+    CHECK_NEAR(middle.x, 5.0f, 1e-5f);
+    CHECK_NEAR(middle.y, 10.0f, 1e-5f);
+    CHECK(Trajectory::Interpolate({1.0f, {0, 0}}, {2.0f, {10, 20}}, 3.0f) == (Point{10, 20}));
+
+    //Short inputs come back unchanged
+    const std::vector<Sample> two{{0.0f, {0, 0}}, {1.0f, {5, 5}}};
+    CHECK(Trajectory::Simplify(two, 1).size() == 2);
+    CHECK(Trajectory::SimplifyTimed({}, 1).empty());
+
+    //Shape simplification keeps the arc within tolerance of its chords, fewer samples for a looser bound
+    const auto curve = arc(500);
+    const auto fine = Trajectory::Simplify(curve, 0.5f);
+    const auto coarse = Trajectory::Simplify(curve, 4.0f);
+    CHECK(sameEnds(fine, curve));
+    CHECK(coarse.size() < fine.size());
+    CHECK(fine.size() < curve.size() / 4);
+    CHECK(coarse.size() >= 3);
+    for (const auto&sample: curve) {
+        float nearest = INFINITY;
+        for (size_t i = 1; i < coarse.size(); i++) {
+            nearest = std::min(nearest, Trajectory::DistanceToLine(coarse[i - 1].second, coarse[i].second,
+                                                                   sample.second));
+        }
+        CHECK(nearest <= 4.0f + 1e-3f);
+    }
+
+    //Timed simplification stays within tolerance at every instant
+    for (float tolerance: {0.5f, 2.0f, 8.0f}) {
+        const auto kept = Trajectory::SimplifyTimed(curve, tolerance);
+        CHECK(sameEnds(kept, curve));
+        CHECK(Trajectory::Deviation(curve, kept) <= tolerance + 1e-3f);
+    }
+
+    //A straight line loses every inner sample to both, a pause only to the shape metric
+    const auto stop = paused();
+    CHECK(Trajectory::Simplify(stop, 1).size() == 2);
+    const auto timed = Trajectory::SimplifyTimed(stop, 1);
+    CHECK(timed.size() == 4);
+    CHECK(Trajectory::Deviation(stop, timed) <= 1.0f + 1e-3f);
+    CHECK(Trajectory::Deviation(stop, Trajectory::Simplify(stop, 1)) > 50);
+    CHECK(Trajectory::Deviation(stop, stop) == 0);
+    CHECK(std::isinf(Trajectory::Deviation(stop, {})));
+
+    //Resampling bounds every step and keeps timing, the fast stretch gets more samples per second
+    const auto sparse = Trajectory::SimplifyTimed(stop, 1);
+    const auto dense = Trajectory::Resample(sparse, 10);
+    CHECK(sameEnds(dense, sparse));
+    size_t slow = 0;
+    size_t fast = 0;
+    for (size_t i = 1; i < dense.size(); i++) {
+        CHECK(Trajectory::Distance(dense[i - 1].second, dense[i].second) <= 10 + 1e-3f);
+        CHECK(dense[i].first >= dense[i - 1].first);
+        const float x = dense[i].second.x;
+        slow += x > 100 && x < 300;
+        fast += x > 300;
+    }
+    CHECK(slow == 19);
+    CHECK(fast == 20);
+    CHECK(Trajectory::Deviation(stop, dense) <= 1.0f + 1e-3f);
+    CHECK(Trajectory::Resample(sparse, 0).size() == sparse.size());
+    return Check::Result();
+}
@@ -0,0 +1,46 @@
+#!/bin/sh
+#Stands in for adb in the broadcast test. Every serial gets its own directory under MIO_FAKE_ADB_ROOT that plays
+#/data/local/tmp and /dev/input: pushed files land there and are listed in push.log, injected input is appended to
+#its event2 and input commands to input.log. Serials containing "small" report a 720x1280 screen, the others 1080x1920, both with a
+#4096x4096 touch panel. Serials containing "offline" fail like an unreachable device.
+[ "$1" = "-s" ] || exit 1
+serial=$2
+verb=$3
+shift 3
+root="$MIO_FAKE_ADB_ROOT/$serial"
+case "$serial" in
+    *offline*)
+        echo "adb: device '$serial' not found" >&2
+        exit 1
+        ;;
+    *small*) size=720x1280 ;;
+    *) size=1080x1920 ;;
+esac
+mkdir -p "$root"
+if [ "$verb" = push ]; then
+    cp "$1" "$root/$(basename "$2")"
+    echo "$2" >> "$root/push.log"
+    exit 0
+fi
+case "$*" in
+    "wm size")
+        echo "Physical size: $size"
+        ;;
+    "getevent -lp")
+        echo "add device 1: /dev/input/event2"
+        echo "  name:     \"fake-touchscreen\""
+        echo "    ABS_MT_POSITION_X     : value 0, min 0, max 4095, fuzz 0, flat 0, resolution 0"
+        echo "    ABS_MT_POSITION_Y     : value 0, min 0, max 4095, fuzz 0, flat 0, resolution 0"
+        ;;
+    "getprop ro.product.cpu.abi")
+        echo arm64-v8a
+        ;;
+    input*)
+        echo "$*" >> "$root/input.log"
+        ;;
+    sh\ *)
+        sed "s#/data/local/tmp#$root#g; s#/dev/input#$root#g" "$root/$(basename "$2")" > "$root/run-$$.sh"
+        sh "$root/run-$$.sh"
+        rm -f "$root/run-$$.sh"
+        ;;
+esac